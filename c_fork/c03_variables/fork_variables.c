@@ -1,6 +1,13 @@
 // GNU C standard library includes
+#define _GNU_SOURCE
 #include <stdio.h>      // io (i.e: printf)
+#include <stdlib.h>     // conversions (i.e: atof)
+#include <string.h>     // memory (i.e: memset)
+#include <time.h>       // clocks (i.e: clock_gettime)
 #include <sys/types.h>  // types (i.e: pid_t)
+#include <sys/mman.h>   // mappings (i.e: mmap, madvise)
+#include <sys/resource.h> // accounting (i.e: getrusage)
+#include <sys/wait.h>   // reaping (i.e: waitpid)
 #include <unistd.h>     // sycalls (i.e: fork)
 
 enum FORK_RETURN {
@@ -19,7 +26,160 @@ enum FORK_RETURN get_fork_result(pid_t fork_result) {
     }
 }
 
-int main() {
+// Copy-on-write experiment: what the divergence of duplicated_variable costs
+// when it happens to a whole heap instead of one int.
+//
+// A heap is allocated with base pages or transparent huge pages and fully
+// touched, the process forks, and the parent or the child writes to a
+// fraction of its pages. The writer reports minor faults (getrusage minflt)
+// and time per fault; the parent reports fork() latency. MADV_DONTFORK keeps
+// the heap out of the child altogether, MADV_WIPEONFORK hands the child zero
+// pages instead of shared ones.
+
+#define HUGE_PAGE (2ul << 20)
+
+enum WRITER {
+    WRITER_PARENT,
+    WRITER_CHILD,
+};
+
+struct Cow {
+    size_t heap;          // bytes
+    int huge;             // MADV_HUGEPAGE instead of base pages
+    int advice;           // 0, MADV_DONTFORK or MADV_WIPEONFORK
+    enum WRITER writer;
+    double fraction;      // of the heap's base pages to write
+};
+
+struct CowResult {
+    double fork_us;
+    long faults;
+    double write_us;
+};
+
+static double now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static long minor_faults(void) {
+    struct rusage ru;
+    getrusage(RUSAGE_SELF, &ru);
+    return ru.ru_minflt;
+}
+
+// Write one byte in every stride-th page; returns faults taken and the time
+static void cow_write(char *heap, struct Cow *c, struct CowResult *r) {
+    size_t page = sysconf(_SC_PAGESIZE);     // 4 KiB on x86, 16 or 64 KiB on some arm64
+    size_t pages = c->heap / page;
+    size_t count = (size_t)(pages * c->fraction);
+    long before = minor_faults();
+    double start = now_us();
+
+    for (size_t i = 0; i < count; i++) {
+        // Spread the writes over the heap instead of a prefix
+        heap[(i * pages / count) * page] = 2;
+    }
+
+    r->write_us = now_us() - start;
+    r->faults = minor_faults() - before;
+}
+
+struct CowResult cow_run(struct Cow c) {
+    struct CowResult r = { 0, 0, 0 };
+
+    char *raw = mmap(NULL, c.heap + HUGE_PAGE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (raw == MAP_FAILED) {
+        perror("mmap");
+        exit(EXIT_FAILURE);
+    }
+    // Huge pages need 2 MiB alignment
+    char *heap = (char *)(((unsigned long)raw + HUGE_PAGE - 1) & ~(HUGE_PAGE - 1));
+    madvise(heap, c.heap, c.huge ? MADV_HUGEPAGE : MADV_NOHUGEPAGE);
+    memset(heap, 1, c.heap);
+    if (c.advice) madvise(heap, c.heap, c.advice);
+
+    int to_child[2], to_parent[2];
+    if (pipe(to_child) == -1 || pipe(to_parent) == -1) {
+        perror("pipe");
+        exit(EXIT_FAILURE);
+    }
+
+    fflush(stdout);
+    double start = now_us();
+    pid_t pid = fork();
+    double forked = now_us();
+
+    switch (get_fork_result(pid)) {
+        case NO_PROCESS:
+            perror("fork");
+            exit(EXIT_FAILURE);
+
+        case CHILD: {
+            struct CowResult mine = { 0, 0, 0 };
+            // Under MADV_DONTFORK the heap is not mapped here at all
+            if (c.writer == WRITER_CHILD && c.advice != MADV_DONTFORK) cow_write(heap, &c, &mine);
+            write(to_parent[1], &mine, sizeof(mine));
+            // Stay alive (sharing the pages) until the parent is done writing
+            char go;
+            read(to_child[0], &go, 1);
+            _exit(0);
+        }
+
+        case PARENT: {
+            struct CowResult theirs;
+            read(to_parent[0], &theirs, sizeof(theirs));
+            if (c.writer == WRITER_PARENT) cow_write(heap, &c, &r);
+            else r = theirs;
+            write(to_child[1], "", 1);
+            waitpid(pid, NULL, 0);
+            break;
+        }
+    }
+
+    r.fork_us = forked - start;
+    close(to_child[0]);
+    close(to_child[1]);
+    close(to_parent[0]);
+    close(to_parent[1]);
+    munmap(raw, c.heap + HUGE_PAGE);
+    return r;
+}
+
+void cow_experiment(size_t heap_mib) {
+    const char *advice_names[] = { "none", "dontfork", "wipeonfork" };
+    int advices[] = { 0, MADV_DONTFORK, MADV_WIPEONFORK };
+    double fractions[] = { 0.0, 0.01, 0.1, 0.5, 1.0 };
+
+    printf("heap %zu MiB; fork in us, faults and ns/fault for the writer\n", heap_mib);
+    printf("%-6s %-10s %-7s %8s %10s %10s %10s\n",
+           "pages", "advice", "writer", "fraction", "fork(us)", "faults", "ns/fault");
+
+    for (int huge = 0; huge <= 1; huge++) {
+        for (int a = 0; a < 3; a++) {
+            for (int w = WRITER_PARENT; w <= WRITER_CHILD; w++) {
+                for (size_t f = 0; f < sizeof(fractions) / sizeof(fractions[0]); f++) {
+                    struct Cow c = { heap_mib << 20, huge, advices[a], w, fractions[f] };
+                    struct CowResult r = cow_run(c);
+
+                    if (w == WRITER_CHILD && advices[a] == MADV_DONTFORK) {
+                        printf("%-6s %-10s %-7s %8.2f %10.1f %10s %10s\n",
+                               huge ? "thp" : "base", advice_names[a], "child", fractions[f],
+                               r.fork_us, "n/a", "n/a");
+                        continue;
+                    }
+                    printf("%-6s %-10s %-7s %8.2f %10.1f %10ld %10.0f\n",
+                           huge ? "thp" : "base", advice_names[a], w == WRITER_PARENT ? "parent" : "child",
+                           fractions[f], r.fork_us, r.faults,
+                           r.faults ? r.write_us * 1e3 / r.faults : 0.0);
+                }
+            }
+        }
+    }
+}
+
+int demo() {
     pid_t process_identifier = getpid();
     pid_t process_parent_identifier= getppid();
 
@@ -61,3 +221,14 @@ int main() {
 
     return 0;
 }
+
+// Usage: ./fork_variables            the duplicated/individual variable demo
+//        ./fork_variables cow [MiB]  copy-on-write cost experiment
+int main(int argc, char *argv[]) {
+    if (argc > 1 && strcmp(argv[1], "cow") == 0) {
+        cow_experiment(argc > 2 ? strtoull(argv[2], NULL, 10) : 256);
+        return 0;
+    }
+
+    return demo();
+}
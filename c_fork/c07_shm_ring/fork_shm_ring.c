@@ -0,0 +1,418 @@
+// Shared-memory ring between a forked producer (parent) and consumer (child).
+//
+// The ring lives in a memfd mapped MAP_SHARED before fork(). Its data area is
+// mapped twice back to back, so a variable-length record that crosses the end
+// of the ring is still contiguous in memory and never has to be split. Both
+// sides only enter the kernel (futex) when the ring is empty or full and the
+// other side announced that it is sleeping.
+//
+// The same traffic is then sent through a pipe, which costs a copy into the
+// kernel, a copy out of it and a syscall per read/write.
+//
+// Both paths are timed alike: the stamp is taken before the producer copies
+// the payload in, and the consumer copies every payload out into its own
+// buffer before checking it, as read() does for the pipe.
+//
+// Usage: ./fork_shm_ring [MiB per size]
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/mman.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
+#define RING_CAPACITY (4u << 20)   // power of two, multiple of the page size
+#define RECORD_HEADER sizeof(uint64_t)
+#define LATENCY_SAMPLES 10000
+
+enum FORK_RESULT {
+    FORK_FAIL = -1,
+    FORK_CHILD = 0,
+    FORK_PARENT = 1,
+};
+
+enum FORK_RESULT check_fork(pid_t pid) {
+    if (pid < 0) return FORK_FAIL;
+    if (pid > 0) return FORK_PARENT;
+    return FORK_CHILD;
+}
+
+static int futex(_Atomic uint32_t *uaddr, int futex_op, uint32_t val) {
+    // Not FUTEX_PRIVATE_FLAG: the word is shared between processes
+    return syscall(SYS_futex, uaddr, futex_op, val, NULL, NULL, 0);
+}
+
+// Producer and consumer fields sit on separate cache lines
+struct RingHeader {
+    _Alignas(64) _Atomic uint64_t head;     // bytes written, owned by producer
+    _Atomic uint32_t space_bell;             // rung by consumer when it frees space
+    _Atomic uint32_t producer_sleeping;
+    _Alignas(64) _Atomic uint64_t tail;     // bytes read, owned by consumer
+    _Atomic uint32_t data_bell;              // rung by producer when it publishes
+    _Atomic uint32_t consumer_sleeping;
+};
+
+struct Ring {
+    struct RingHeader *h;
+    uint8_t *data;        // RING_CAPACITY bytes, mapped twice in a row
+    uint64_t mask;
+};
+
+struct Ring ring_create(void) {
+    struct Ring r = { NULL, NULL, RING_CAPACITY - 1 };
+    long page = sysconf(_SC_PAGESIZE);
+
+    int fd = memfd_create("shm_ring", 0);
+    if (fd == -1) {
+        perror("memfd_create");
+        exit(EXIT_FAILURE);
+    }
+    if (ftruncate(fd, page + RING_CAPACITY) == -1) {
+        perror("ftruncate");
+        exit(EXIT_FAILURE);
+    }
+
+    // Reserve header page + two copies of the data, then map over it
+    uint8_t *base = mmap(NULL, page + 2 * RING_CAPACITY, PROT_NONE,
+                         MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (base == MAP_FAILED) {
+        perror("mmap reserve");
+        exit(EXIT_FAILURE);
+    }
+    if (mmap(base, page, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0) == MAP_FAILED ||
+        mmap(base + page, RING_CAPACITY, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, page) == MAP_FAILED ||
+        mmap(base + page + RING_CAPACITY, RING_CAPACITY, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, page) == MAP_FAILED) {
+        perror("mmap ring");
+        exit(EXIT_FAILURE);
+    }
+    close(fd);
+
+    r.h = (struct RingHeader *)base;
+    r.data = base + page;
+    memset(r.h, 0, sizeof(*r.h));
+    return r;
+}
+
+static uint64_t record_size(uint64_t len) {
+    return RECORD_HEADER + ((len + 7) & ~(uint64_t)7);
+}
+
+// Sleep on a doorbell until the ring has room/data. The sleeping flag and index are
+// both seq_cst so that either the waker sees the flag or the sleeper sees the
+// new index (no lost wakeup).
+static void ring_wait_space(struct Ring *r, uint64_t head, uint64_t need) {
+    while (RING_CAPACITY - (head - atomic_load(&r->h->tail)) < need) {
+        uint32_t bell = atomic_load(&r->h->space_bell);
+        atomic_store(&r->h->producer_sleeping, 1);
+        if (RING_CAPACITY - (head - atomic_load(&r->h->tail)) >= need) {
+            atomic_store(&r->h->producer_sleeping, 0);
+            break;
+        }
+        futex(&r->h->space_bell, FUTEX_WAIT, bell);
+        atomic_store(&r->h->producer_sleeping, 0);
+    }
+}
+
+static void ring_wait_data(struct Ring *r, uint64_t tail) {
+    while (atomic_load(&r->h->head) == tail) {
+        uint32_t bell = atomic_load(&r->h->data_bell);
+        atomic_store(&r->h->consumer_sleeping, 1);
+        if (atomic_load(&r->h->head) != tail) {
+            atomic_store(&r->h->consumer_sleeping, 0);
+            break;
+        }
+        futex(&r->h->data_bell, FUTEX_WAIT, bell);
+        atomic_store(&r->h->consumer_sleeping, 0);
+    }
+}
+
+// Reserve a record of len bytes and return where its payload goes
+uint8_t *ring_reserve(struct Ring *r, uint64_t len) {
+    uint64_t head = atomic_load_explicit(&r->h->head, memory_order_relaxed);
+    ring_wait_space(r, head, record_size(len));
+    uint8_t *rec = r->data + (head & r->mask);
+    memcpy(rec, &len, RECORD_HEADER);
+    return rec + RECORD_HEADER;
+}
+
+void ring_publish(struct Ring *r, uint64_t len) {
+    uint64_t head = atomic_load_explicit(&r->h->head, memory_order_relaxed);
+    atomic_store(&r->h->head, head + record_size(len));
+    if (atomic_load(&r->h->consumer_sleeping)) {
+        atomic_fetch_add(&r->h->data_bell, 1);
+        futex(&r->h->data_bell, FUTEX_WAKE, 1);
+    }
+}
+
+// Peek the next record in place; returns its payload and stores its length
+uint8_t *ring_peek(struct Ring *r, uint64_t *len) {
+    uint64_t tail = atomic_load_explicit(&r->h->tail, memory_order_relaxed);
+    ring_wait_data(r, tail);
+    uint8_t *rec = r->data + (tail & r->mask);
+    memcpy(len, rec, RECORD_HEADER);
+    return rec + RECORD_HEADER;
+}
+
+void ring_release(struct Ring *r, uint64_t len) {
+    uint64_t tail = atomic_load_explicit(&r->h->tail, memory_order_relaxed);
+    atomic_store(&r->h->tail, tail + record_size(len));
+    if (atomic_load(&r->h->producer_sleeping)) {
+        atomic_fetch_add(&r->h->space_bell, 1);
+        futex(&r->h->space_bell, FUTEX_WAKE, 1);
+    }
+}
+
+// Wait until the consumer drained everything (used for unloaded latency)
+void ring_drain(struct Ring *r) {
+    uint64_t head = atomic_load_explicit(&r->h->head, memory_order_relaxed);
+    ring_wait_space(r, head, RING_CAPACITY);
+}
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static int compare_u64(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+// Result shared back from the consumer child
+struct Result {
+    double seconds;
+    uint64_t bytes;
+    uint64_t p50_ns;
+    uint64_t p99_ns;
+    uint64_t max_ns;
+    uint64_t errors;
+};
+
+struct Run {
+    size_t size;          // payload bytes per message (>= 8, holds the stamp)
+    size_t messages;
+    int synchronous;      // wait for each message to be consumed (latency run)
+};
+
+static void latency_summary(struct Result *res, uint64_t *lat, size_t n) {
+    if (n == 0) return;
+    qsort(lat, n, sizeof(*lat), compare_u64);
+    res->p50_ns = lat[n / 2];
+    res->p99_ns = lat[(n * 99) / 100];
+    res->max_ns = lat[n - 1];
+}
+
+static void consume(const uint8_t *payload, size_t len, size_t i,
+                    uint64_t *lat, size_t *nlat, struct Result *res) {
+    uint64_t stamp;
+    memcpy(&stamp, payload, sizeof(stamp));
+    if (*nlat < LATENCY_SAMPLES) lat[(*nlat)++] = now_ns() - stamp;
+    if (payload[len - 1] != (uint8_t)i) res->errors++;
+    res->bytes += len;
+}
+
+// ---- shared-memory ring path ----
+
+void ring_run(struct Ring *r, struct Run run, struct Result *res, uint8_t *source) {
+    fflush(stdout);
+    pid_t pid = fork();
+
+    switch (check_fork(pid)) {
+        case FORK_FAIL:
+            perror("fork");
+            exit(EXIT_FAILURE);
+
+        case FORK_CHILD: {
+            uint8_t *buffer = malloc(run.size);
+            uint64_t *lat = malloc(LATENCY_SAMPLES * sizeof(*lat));
+            size_t nlat = 0;
+            uint64_t start = now_ns();
+            for (size_t i = 0; i < run.messages; i++) {
+                uint64_t len;
+                uint8_t *payload = ring_peek(r, &len);
+                // Copy out like read() would, so the comparison is like-for-like
+                if (len > run.size) {
+                    res->errors++;
+                    len = run.size;
+                }
+                memcpy(buffer, payload, len);
+                ring_release(r, len);
+                consume(buffer, len, i, lat, &nlat, res);
+            }
+            res->seconds = (now_ns() - start) / 1e9;
+            latency_summary(res, lat, nlat);
+            free(lat);
+            free(buffer);
+            exit(0);
+        }
+
+        case FORK_PARENT:
+            for (size_t i = 0; i < run.messages; i++) {
+                uint8_t *payload = ring_reserve(r, run.size);
+                source[run.size - 1] = (uint8_t)i;
+                // Stamp before the copy, as the pipe path stamps before write()
+                uint64_t stamp = now_ns();
+                memcpy(source, &stamp, sizeof(stamp));
+                memcpy(payload, source, run.size);
+                ring_publish(r, run.size);
+                if (run.synchronous) ring_drain(r);
+            }
+            waitpid(pid, NULL, 0);
+            break;
+    }
+}
+
+// ---- pipe path ----
+
+static int read_full(int fd, void *buf, size_t len) {
+    uint8_t *p = buf;
+    while (len > 0) {
+        ssize_t n = read(fd, p, len);
+        if (n <= 0) {
+            if (n == -1 && errno == EINTR) continue;
+            return -1;
+        }
+        p += n;
+        len -= n;
+    }
+    return 0;
+}
+
+static int write_full(int fd, const void *buf, size_t len) {
+    const uint8_t *p = buf;
+    while (len > 0) {
+        ssize_t n = write(fd, p, len);
+        if (n <= 0) {
+            if (n == -1 && errno == EINTR) continue;
+            return -1;
+        }
+        p += n;
+        len -= n;
+    }
+    return 0;
+}
+
+void pipe_run(struct Run run, struct Result *res, uint8_t *source) {
+    int data_fd[2], ack_fd[2];
+    if (pipe(data_fd) == -1 || pipe(ack_fd) == -1) {
+        perror("pipe");
+        exit(EXIT_FAILURE);
+    }
+
+    fflush(stdout);
+    pid_t pid = fork();
+
+    switch (check_fork(pid)) {
+        case FORK_FAIL:
+            perror("fork");
+            exit(EXIT_FAILURE);
+
+        case FORK_CHILD: {
+            close(data_fd[1]);
+            close(ack_fd[0]);
+            uint8_t *buffer = malloc(run.size);
+            uint64_t *lat = malloc(LATENCY_SAMPLES * sizeof(*lat));
+            size_t nlat = 0;
+            uint64_t start = now_ns();
+            for (size_t i = 0; i < run.messages; i++) {
+                uint64_t len;
+                if (read_full(data_fd[0], &len, sizeof(len)) == -1 ||
+                    read_full(data_fd[0], buffer, len) == -1) {
+                    res->errors++;
+                    break;
+                }
+                consume(buffer, len, i, lat, &nlat, res);
+                if (run.synchronous) write_full(ack_fd[1], "", 1);
+            }
+            res->seconds = (now_ns() - start) / 1e9;
+            latency_summary(res, lat, nlat);
+            free(lat);
+            free(buffer);
+            exit(0);
+        }
+
+        case FORK_PARENT: {
+            close(data_fd[0]);
+            close(ack_fd[1]);
+            uint64_t len = run.size;
+            for (size_t i = 0; i < run.messages; i++) {
+                source[run.size - 1] = (uint8_t)i;
+                uint64_t stamp = now_ns();
+                memcpy(source, &stamp, sizeof(stamp));
+                write_full(data_fd[1], &len, sizeof(len));
+                write_full(data_fd[1], source, run.size);
+                if (run.synchronous) {
+                    char ack;
+                    read_full(ack_fd[0], &ack, 1);
+                }
+            }
+            close(data_fd[1]);
+            close(ack_fd[0]);
+            waitpid(pid, NULL, 0);
+            break;
+        }
+    }
+}
+
+void report(const char *path, const char *mode, struct Run run, struct Result *res) {
+    printf("%-5s %-10s %8zu %9zu %10.1f %10.2f %10.2f %10.2f %s\n",
+           path, mode, run.size, run.messages,
+           res->bytes / res->seconds / (1 << 20),
+           res->p50_ns / 1e3, res->p99_ns / 1e3, res->max_ns / 1e3,
+           res->errors ? "CORRUPT" : "ok");
+}
+
+int main(int argc, char *argv[]) {
+    size_t mib = argc > 1 ? strtoull(argv[1], NULL, 10) : 256;
+    size_t sizes[] = { 64, 256, 1024, 4096, 16384, 65536, 262144, 1048576 };
+    size_t nsizes = sizeof(sizes) / sizeof(sizes[0]);
+
+    struct Ring r = ring_create();
+    struct Result *res = mmap(NULL, sizeof(*res), PROT_READ | PROT_WRITE,
+                              MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    uint8_t *source = malloc(sizes[nsizes - 1]);
+    if (res == MAP_FAILED || source == NULL) {
+        perror("alloc");
+        exit(EXIT_FAILURE);
+    }
+    memset(source, 'x', sizes[nsizes - 1]);
+
+    printf("%-5s %-10s %8s %9s %10s %10s %10s %10s\n",
+           "path", "mode", "bytes", "messages", "MiB/s", "p50(us)", "p99(us)", "max(us)");
+
+    for (size_t s = 0; s < nsizes; s++) {
+        size_t stream = (mib << 20) / sizes[s];
+        size_t sync = (64u << 20) / sizes[s];
+        if (stream < 16) stream = 16;
+        if (sync > LATENCY_SAMPLES) sync = LATENCY_SAMPLES;
+        if (sync < 16) sync = 16;
+
+        struct Run runs[] = {
+            { sizes[s], stream, 0 },
+            { sizes[s], sync, 1 },
+        };
+
+        for (size_t k = 0; k < 2; k++) {
+            const char *mode = runs[k].synchronous ? "one-by-one" : "stream";
+
+            memset(res, 0, sizeof(*res));
+            ring_run(&r, runs[k], res, source);
+            report("ring", mode, runs[k], res);
+
+            memset(res, 0, sizeof(*res));
+            pipe_run(runs[k], res, source);
+            report("pipe", mode, runs[k], res);
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,363 @@
+// Zero-copy capture of a child's stdout.
+//
+// tarefa4/main.c read()s the pipe into a 4096-byte buffer and printf()s it,
+// so every byte is copied kernel->user->stdio->kernel. Here the parent moves
+// the pipe contents to their destination with splice(2), never touching them:
+//
+//   printf  read() + printf(), as in tarefa4 (baseline)
+//   copy    read() + write() with the same 4096-byte buffer
+//   splice  pipe -> destination with splice()
+//   tee     pipe -> stdout and pipe -> file, duplicated in-kernel with tee()
+//   memfd   pipe -> memfd with splice(), then mmap()ed by the parent
+//
+// Usage: ./fork_splice <mode> [file] [-- cmd args...]   (default cmd: ls -l)
+//        ./fork_splice bench [GiB]
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+#include <sys/wait.h>
+
+#define BUFFER_SIZE 4096
+#define SPLICE_CHUNK (1 << 20)
+#define GENERATOR_CHUNK (1 << 16)
+
+enum PID {
+    PID_PARENT,
+    PID_CHILD,
+    PID_FAIL,
+};
+
+enum PID check(pid_t pid) {
+    if (pid == 0) {
+        return PID_CHILD;
+    } else if (pid > 0) {
+        return PID_PARENT;
+    }
+    return PID_FAIL;
+}
+
+enum Capture {
+    CAPTURE_PRINTF,
+    CAPTURE_COPY,
+    CAPTURE_SPLICE,
+    CAPTURE_TEE,
+    CAPTURE_MEMFD,
+};
+
+const char *capture_names[] = { "printf", "copy", "splice", "tee", "memfd" };
+
+int capture_from_name(const char *name) {
+    for (size_t c = 0; c < sizeof(capture_names) / sizeof(capture_names[0]); c++) {
+        if (strcmp(name, capture_names[c]) == 0) return c;
+    }
+    return -1;
+}
+
+// Where captured output ends up; tee uses both, memfd fills map/length
+struct Sink {
+    int out;            // stdout or file
+    int file;           // second destination for tee, -1 otherwise
+    uint8_t *map;       // memfd contents after capture
+    size_t length;
+};
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int write_full(int fd, const char *p, size_t len) {
+    while (len > 0) {
+        ssize_t n = write(fd, p, len);
+        if (n == -1) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        p += n;
+        len -= n;
+    }
+    return 0;
+}
+
+ssize_t capture_printf(int in, struct Sink *sink) {
+    static char buffer[BUFFER_SIZE];
+    FILE *out = fdopen(dup(sink->out), "w");
+    ssize_t total = 0, n;
+
+    while ((n = read(in, buffer, BUFFER_SIZE - 1)) > 0) {
+        buffer[n] = '\0';
+        fprintf(out, "%s", buffer);
+        total += n;
+    }
+    fclose(out);
+    return n == -1 ? -1 : total;
+}
+
+ssize_t capture_copy(int in, struct Sink *sink) {
+    static char buffer[BUFFER_SIZE];
+    ssize_t total = 0, n;
+
+    while ((n = read(in, buffer, BUFFER_SIZE)) > 0) {
+        if (write_full(sink->out, buffer, n) == -1) return -1;
+        total += n;
+    }
+    return n == -1 ? -1 : total;
+}
+
+// Move exactly len bytes from a pipe to out. Destinations splice refuses
+// (terminals, O_APPEND files) get the bytes through a bounce buffer instead.
+static int splice_full(int in, int out, size_t len) {
+    static char buffer[BUFFER_SIZE];
+
+    while (len > 0) {
+        ssize_t n = splice(in, NULL, out, NULL, len, SPLICE_F_MOVE | SPLICE_F_MORE);
+        if (n == -1 && errno == EINVAL) {
+            n = read(in, buffer, len < BUFFER_SIZE ? len : BUFFER_SIZE);
+            if (n > 0 && write_full(out, buffer, n) == -1) return -1;
+        }
+        if (n <= 0) {
+            if (n == -1 && errno == EINTR) continue;
+            return -1;
+        }
+        len -= n;
+    }
+    return 0;
+}
+
+ssize_t capture_splice(int in, struct Sink *sink) {
+    ssize_t total = 0, n;
+
+    while ((n = splice(in, NULL, sink->out, NULL, SPLICE_CHUNK, SPLICE_F_MOVE | SPLICE_F_MORE)) > 0) {
+        total += n;
+    }
+    if (n == -1 && errno == EINVAL && total == 0) {
+        // Destination cannot splice (terminal, O_APPEND file): fall back to copying
+        return capture_copy(in, sink);
+    }
+    return n == -1 ? -1 : total;
+}
+
+ssize_t capture_tee(int in, struct Sink *sink) {
+    int dup_pipe[2];
+    if (pipe(dup_pipe) == -1) return -1;
+
+    ssize_t total = 0, n;
+    // tee() duplicates what is in the pipe without consuming it; the copy
+    // goes to the file and the original is then spliced out to stdout
+    while ((n = tee(in, dup_pipe[1], SPLICE_CHUNK, 0)) > 0) {
+        if (splice_full(dup_pipe[0], sink->file, n) == -1 ||
+            splice_full(in, sink->out, n) == -1) {
+            n = -1;
+            break;
+        }
+        total += n;
+    }
+    close(dup_pipe[0]);
+    close(dup_pipe[1]);
+    return n == -1 ? -1 : total;
+}
+
+ssize_t capture_memfd(int in, struct Sink *sink) {
+    int mfd = memfd_create("fork_splice", 0);
+    if (mfd == -1) return -1;
+
+    ssize_t total = 0, n;
+    while ((n = splice(in, NULL, mfd, NULL, SPLICE_CHUNK, SPLICE_F_MOVE | SPLICE_F_MORE)) > 0) {
+        total += n;
+    }
+    if (n == -1) {
+        close(mfd);
+        return -1;
+    }
+
+    sink->length = total;
+    sink->map = NULL;
+    if (total > 0) {
+        sink->map = mmap(NULL, total, PROT_READ, MAP_SHARED, mfd, 0);
+        if (sink->map == MAP_FAILED) sink->map = NULL;
+    }
+    close(mfd);
+    return total;
+}
+
+ssize_t capture(enum Capture mode, int in, struct Sink *sink) {
+    switch (mode) {
+        case CAPTURE_PRINTF: return capture_printf(in, sink);
+        case CAPTURE_COPY:   return capture_copy(in, sink);
+        case CAPTURE_SPLICE: return capture_splice(in, sink);
+        case CAPTURE_TEE:    return capture_tee(in, sink);
+        case CAPTURE_MEMFD:  return capture_memfd(in, sink);
+    }
+    return -1;
+}
+
+// Child side: stdout goes to the pipe, then either exec a command or, for
+// the benchmark, push `bytes` of output with vmsplice so the child is never
+// the bottleneck
+void child(int pipe_fd[2], char *argv[], size_t bytes) {
+    close(pipe_fd[0]);
+
+    if (dup2(pipe_fd[1], STDOUT_FILENO) == -1) {
+        perror("dup2");
+        exit(EXIT_FAILURE);
+    }
+    close(pipe_fd[1]);
+
+    if (argv != NULL) {
+        execvp(argv[0], argv);
+        perror("execvp");
+        exit(EXIT_FAILURE);
+    }
+
+    static char chunk[GENERATOR_CHUNK];
+    memset(chunk, 'x', sizeof(chunk));
+    for (size_t i = 63; i < sizeof(chunk); i += 64) chunk[i] = '\n';
+
+    while (bytes > 0) {
+        size_t len = bytes < sizeof(chunk) ? bytes : sizeof(chunk);
+        struct iovec iov = { chunk, len };
+        ssize_t n = vmsplice(STDOUT_FILENO, &iov, 1, 0);
+        if (n == -1) {
+            if (write_full(STDOUT_FILENO, chunk, len) == -1) exit(EXIT_FAILURE);
+            n = len;
+        }
+        bytes -= n;
+    }
+    exit(0);
+}
+
+// Spawn the child and capture its stdout; returns captured bytes
+ssize_t run(enum Capture mode, struct Sink *sink, char *argv[], size_t bytes) {
+    int pipe_fd[2];
+    if (pipe(pipe_fd) == -1) {
+        perror("pipe");
+        exit(EXIT_FAILURE);
+    }
+
+    fflush(stdout);
+    pid_t pid = fork();
+    ssize_t total = -1;
+
+    switch (check(pid)) {
+        case PID_FAIL:
+            perror("fork");
+            exit(EXIT_FAILURE);
+        case PID_CHILD:
+            child(pipe_fd, argv, bytes);
+            break;
+        case PID_PARENT:
+            close(pipe_fd[1]);
+            total = capture(mode, pipe_fd[0], sink);
+            if (total == -1) perror(capture_names[mode]);
+            close(pipe_fd[0]);
+            waitpid(pid, NULL, 0);
+            break;
+    }
+    return total;
+}
+
+void bench(size_t gib) {
+    size_t bytes = gib << 30;
+    const char *file = "/tmp/fork_splice.out";
+    int devnull = open("/dev/null", O_WRONLY);
+
+    printf("%-8s %-14s %10s %10s\n", "mode", "destination", "GiB", "GiB/s");
+    for (int m = CAPTURE_PRINTF; m <= CAPTURE_MEMFD; m++) {
+        for (int to_file = 0; to_file <= 1; to_file++) {
+            if ((m == CAPTURE_TEE || m == CAPTURE_MEMFD) && to_file) continue;
+
+            int fd = -1;
+            if (to_file || m == CAPTURE_TEE) {
+                fd = open(file, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+                if (fd == -1) {
+                    perror(file);
+                    exit(EXIT_FAILURE);
+                }
+            }
+
+            struct Sink sink = { to_file ? fd : devnull, fd, NULL, 0 };
+            double start = now();
+            ssize_t total = run(m, &sink, NULL, bytes);
+            double elapsed = now() - start;
+
+            const char *dest = m == CAPTURE_TEE ? "/dev/null+file"
+                             : m == CAPTURE_MEMFD ? "memfd"
+                             : to_file ? "file" : "/dev/null";
+            printf("%-8s %-14s %10.2f %10.2f\n", capture_names[m], dest,
+                   total / (double)(1 << 30), total / elapsed / (1 << 30));
+
+            if (sink.map) munmap(sink.map, sink.length);
+            if (fd != -1) close(fd);
+            unlink(file);
+        }
+    }
+    close(devnull);
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 2) {
+        fprintf(stderr, "usage: %s printf|copy|splice|tee|memfd [file] [-- cmd args...]\n"
+                        "       %s bench [GiB]\n", argv[0], argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    if (strcmp(argv[1], "bench") == 0) {
+        bench(argc > 2 ? strtoull(argv[2], NULL, 10) : 2);
+        return 0;
+    }
+
+    int mode = capture_from_name(argv[1]);
+    if (mode == -1) {
+        fprintf(stderr, "unknown mode %s\n", argv[1]);
+        return EXIT_FAILURE;
+    }
+
+    char *file = NULL;
+    char *default_cmd[] = { "ls", "-l", NULL };
+    char **cmd = default_cmd;
+    for (int a = 2; a < argc; a++) {
+        if (strcmp(argv[a], "--") == 0) {
+            if (a + 1 < argc) cmd = &argv[a + 1];
+            break;
+        }
+        file = argv[a];
+    }
+
+    struct Sink sink = { STDOUT_FILENO, -1, NULL, 0 };
+    if (file != NULL) {
+        int fd = open(file, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd == -1) {
+            perror(file);
+            return EXIT_FAILURE;
+        }
+        // tee keeps stdout and adds the file; every other mode writes to the file
+        if (mode == CAPTURE_TEE) sink.file = fd;
+        else sink.out = fd;
+    } else if (mode == CAPTURE_TEE) {
+        fprintf(stderr, "tee needs a file\n");
+        return EXIT_FAILURE;
+    }
+
+    ssize_t total = run(mode, &sink, cmd, 0);
+
+    if (mode == CAPTURE_MEMFD && sink.map != NULL) {
+        // The capture is now plain memory in the parent
+        size_t lines = 0;
+        for (const uint8_t *p = sink.map; (p = memchr(p, '\n', sink.map + sink.length - p)); p++) lines++;
+        write_full(sink.out, (const char *)sink.map, sink.length);
+        fprintf(stderr, "memfd: %zu bytes, %zu lines mapped at %p\n", sink.length, lines, (void *)sink.map);
+        munmap(sink.map, sink.length);
+    }
+
+    return total == -1 ? EXIT_FAILURE : 0;
+}
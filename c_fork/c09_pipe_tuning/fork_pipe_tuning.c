@@ -0,0 +1,260 @@
+// Pipe capacity and read batching for child output redirection.
+//
+// tarefa4/main.c reads the child's pipe with a fixed BUFFER_SIZE 4096 and
+// leaves the pipe at its default 64 KiB capacity (16 pages), so every 64 KiB
+// the writer blocks and every 4 KiB the reader makes a syscall. Here both are
+// parameters:
+//
+//   -p bytes   pipe capacity, set with F_SETPIPE_SZ (rounded up by the kernel)
+//   -r bytes   bytes requested per read (upper bound when adaptive)
+//   -v count   split every read into count buffers with readv()
+//   -a         adaptive read size: double when a read fills the buffer,
+//              halve when it comes back less than a quarter full
+//
+// Usage: ./fork_pipe_tuning [-p N] [-r N] [-v N] [-a] [-- cmd args...]
+//        ./fork_pipe_tuning sweep [MiB] [child write size]
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+#include <sys/wait.h>
+
+#define BUFFER_SIZE 4096
+#define MAX_IOV 64
+
+enum PID {
+    PID_PARENT,
+    PID_CHILD,
+    PID_FAIL,
+};
+
+enum PID check(pid_t pid) {
+    if (pid == 0) {
+        return PID_CHILD;
+    } else if (pid > 0) {
+        return PID_PARENT;
+    }
+    return PID_FAIL;
+}
+
+struct Tuning {
+    int pipe_size;        // 0 keeps the kernel default
+    size_t read_size;
+    int iovcnt;           // 1 uses plain read()
+    bool adaptive;
+};
+
+struct Stats {
+    size_t bytes;
+    size_t reads;
+    int pipe_size;        // capacity actually granted
+    double seconds;
+};
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Returns the capacity the kernel granted, which may be larger than asked
+int set_pipe_size(int fd, int size) {
+    if (size > 0 && fcntl(fd, F_SETPIPE_SZ, size) == -1) {
+        perror("F_SETPIPE_SZ");
+    }
+    return fcntl(fd, F_GETPIPE_SZ);
+}
+
+// Read the pipe until EOF, forwarding to out (or just counting when out < 0)
+int drain(int in, int out, struct Tuning t, struct Stats *s) {
+    char *buffer = malloc(t.read_size);
+    if (buffer == NULL) return -1;
+
+    size_t want = t.adaptive ? BUFFER_SIZE : t.read_size;
+    if (want > t.read_size) want = t.read_size;
+
+    for (;;) {
+        ssize_t n;
+
+        if (t.iovcnt > 1) {
+            struct iovec iov[MAX_IOV];
+            size_t part = want / t.iovcnt;
+            for (int i = 0; i < t.iovcnt; i++) {
+                iov[i].iov_base = buffer + i * part;
+                iov[i].iov_len = part;
+            }
+            n = readv(in, iov, t.iovcnt);
+        } else {
+            n = read(in, buffer, want);
+        }
+
+        if (n == 0) break;
+        if (n == -1) {
+            if (errno == EINTR) continue;
+            free(buffer);
+            return -1;
+        }
+
+        s->bytes += n;
+        s->reads++;
+
+        if (out >= 0) {
+            for (ssize_t w = 0, k; w < n; w += k) {
+                k = write(out, buffer + w, n - w);
+                if (k == -1) {
+                    free(buffer);
+                    return -1;
+                }
+            }
+        }
+
+        if (t.adaptive) {
+            if ((size_t)n == want && want < t.read_size) want *= 2;
+            else if ((size_t)n < want / 4 && want > BUFFER_SIZE) want /= 2;
+        }
+    }
+
+    free(buffer);
+    return 0;
+}
+
+// Child: stdout into the pipe, then exec argv or emit `bytes` with write()
+void child(int pipe_fd[2], char *argv[], size_t bytes, size_t write_size) {
+    close(pipe_fd[0]);
+
+    if (dup2(pipe_fd[1], STDOUT_FILENO) == -1) {
+        perror("dup2");
+        exit(EXIT_FAILURE);
+    }
+    close(pipe_fd[1]);
+
+    if (argv != NULL) {
+        execvp(argv[0], argv);
+        perror("execvp");
+        exit(EXIT_FAILURE);
+    }
+
+    char *chunk = malloc(write_size);
+    memset(chunk, 'x', write_size);
+    while (bytes > 0) {
+        size_t len = bytes < write_size ? bytes : write_size;
+        ssize_t n = write(STDOUT_FILENO, chunk, len);
+        if (n == -1) exit(EXIT_FAILURE);
+        bytes -= n;
+    }
+    exit(0);
+}
+
+struct Stats run(struct Tuning t, int out, char *argv[], size_t bytes, size_t write_size) {
+    struct Stats s = { 0, 0, 0, 0 };
+    int pipe_fd[2];
+
+    if (pipe(pipe_fd) == -1) {
+        perror("pipe");
+        exit(EXIT_FAILURE);
+    }
+    s.pipe_size = set_pipe_size(pipe_fd[0], t.pipe_size);
+
+    fflush(stdout);
+    double start = now();
+    pid_t pid = fork();
+
+    switch (check(pid)) {
+        case PID_FAIL:
+            perror("fork");
+            exit(EXIT_FAILURE);
+        case PID_CHILD:
+            child(pipe_fd, argv, bytes, write_size);
+            break;
+        case PID_PARENT:
+            close(pipe_fd[1]);
+            if (drain(pipe_fd[0], out, t, &s) == -1) perror("read");
+            close(pipe_fd[0]);
+            waitpid(pid, NULL, 0);
+            break;
+    }
+
+    s.seconds = now() - start;
+    return s;
+}
+
+void sweep(size_t mib, size_t write_size) {
+    int pipe_sizes[] = { 4096, 16384, 65536, 262144, 1048576 };
+    size_t read_sizes[] = { 4096, 16384, 65536, 262144, 1048576 };
+    int npipes = sizeof(pipe_sizes) / sizeof(pipe_sizes[0]);
+    int nreads = sizeof(read_sizes) / sizeof(read_sizes[0]);
+    size_t bytes = mib << 20;
+
+    struct {
+        const char *name;
+        int iovcnt;
+        bool adaptive;
+    } variants[] = {
+        { "read", 1, false },
+        { "readv x4", 4, false },
+        { "adaptive", 1, true },
+    };
+
+    printf("GiB/s moving %zu MiB, child writes of %zu bytes\n", mib, write_size);
+    for (size_t v = 0; v < sizeof(variants) / sizeof(variants[0]); v++) {
+        printf("\n%-10s", variants[v].name);
+        for (int r = 0; r < nreads; r++) printf(" %9zuK", read_sizes[r] >> 10);
+        printf("   (columns: read size, rows: pipe size)\n");
+
+        for (int p = 0; p < npipes; p++) {
+            int granted = 0;
+            printf("%9dK", pipe_sizes[p] >> 10);
+            for (int r = 0; r < nreads; r++) {
+                struct Tuning t = { pipe_sizes[p], read_sizes[r], variants[v].iovcnt, variants[v].adaptive };
+                struct Stats s = run(t, -1, NULL, bytes, write_size);
+                granted = s.pipe_size;
+                printf(" %10.2f", s.bytes / s.seconds / (1 << 30));
+                fflush(stdout);
+            }
+            if (granted != pipe_sizes[p]) printf("   (granted %dK)", granted >> 10);
+            printf("\n");
+        }
+    }
+}
+
+int main(int argc, char *argv[]) {
+    if (argc > 1 && strcmp(argv[1], "sweep") == 0) {
+        sweep(argc > 2 ? strtoull(argv[2], NULL, 10) : 1024,
+              argc > 3 ? strtoull(argv[3], NULL, 10) : 65536);
+        return 0;
+    }
+
+    struct Tuning t = { 0, BUFFER_SIZE, 1, false };
+    char *default_cmd[] = { "ls", "-l", NULL };
+    char **cmd = default_cmd;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "p:r:v:a")) != -1) {
+        switch (opt) {
+            case 'p': t.pipe_size = atoi(optarg); break;
+            case 'r': t.read_size = strtoull(optarg, NULL, 10); break;
+            case 'v': t.iovcnt = atoi(optarg); break;
+            case 'a': t.adaptive = true; break;
+            default:
+                fprintf(stderr, "usage: %s [-p pipe] [-r read] [-v iovcnt] [-a] [-- cmd args...]\n"
+                                "       %s sweep [MiB] [child write size]\n", argv[0], argv[0]);
+                return EXIT_FAILURE;
+        }
+    }
+    if (optind < argc) cmd = &argv[optind];
+    if (t.iovcnt < 1) t.iovcnt = 1;
+    if (t.iovcnt > MAX_IOV) t.iovcnt = MAX_IOV;
+    if (t.read_size < (size_t)t.iovcnt) t.read_size = t.iovcnt;
+
+    struct Stats s = run(t, STDOUT_FILENO, cmd, 0, 0);
+    fprintf(stderr, "%zu bytes in %zu reads, pipe %d bytes, %.3f s\n",
+            s.bytes, s.reads, s.pipe_size, s.seconds);
+    return 0;
+}
@@ -0,0 +1,617 @@
+// Collect stdout/stderr of many children concurrently.
+//
+// tarefa4/main.c waits on a single child with a blocking read() until EOF.
+// Here N children are spawned up front, each with its own stdout and stderr
+// pipe, and every pipe is serviced from one event loop:
+//
+//   epoll  all read ends (O_NONBLOCK) in one epoll instance, read on readiness
+//   uring  io_uring multishot reads that pick buffers from a provided buffer
+//          ring; re-armed single-shot reads on kernels without multishot
+//
+// Output is demultiplexed per child and stream. The benchmark reports
+// aggregate throughput and per-child latency (first byte, completion).
+//
+// Usage: ./fork_collector epoll|uring "cmd 1" "cmd 2" ...
+//        ./fork_collector bench [KiB per child]
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <linux/io_uring.h>
+
+#ifndef IORING_OP_READ_MULTISHOT
+#define IORING_OP_READ_MULTISHOT 49   // Linux 6.7
+#endif
+
+#define BUFFER_SIZE 16384
+#define EPOLL_BATCH 256
+#define URING_ENTRIES 4096
+#define URING_BUFFERS 1024            // provided buffers, power of two
+#define URING_GROUP 0
+#define GENERATOR_WRITE 4096
+
+enum PID {
+    PID_PARENT,
+    PID_CHILD,
+    PID_FAIL,
+};
+
+enum PID check(pid_t pid) {
+    if (pid == 0) {
+        return PID_CHILD;
+    } else if (pid > 0) {
+        return PID_PARENT;
+    }
+    return PID_FAIL;
+}
+
+enum Backend {
+    BACKEND_EPOLL,
+    BACKEND_URING,
+};
+
+const char *backend_names[] = { "epoll", "uring" };
+
+struct Stream {
+    int fd;               // -1 once EOF was seen
+    size_t bytes;
+    char *data;           // kept only when the collector stores output
+    size_t capacity;
+};
+
+struct Child {
+    pid_t pid;
+    const char *cmd;      // NULL for benchmark generators
+    struct Stream stream[2];  // 0: stdout, 1: stderr
+    int open;
+    int status;
+    double spawned;
+    double first_byte;
+    double done;
+};
+
+struct Collector {
+    struct Child *children;
+    size_t n;
+    size_t open_streams;
+    bool keep;            // store output for the demultiplexed dump
+};
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static uint64_t tag(size_t child, int stream) {
+    return ((uint64_t)child << 1) | stream;
+}
+
+// ---- child side ----
+
+void generator(size_t bytes) {
+    static char chunk[GENERATOR_WRITE];
+    memset(chunk, 'x', sizeof(chunk));
+    chunk[sizeof(chunk) - 1] = '\n';
+
+    while (bytes > 0) {
+        size_t len = bytes < sizeof(chunk) ? bytes : sizeof(chunk);
+        ssize_t n = write(STDOUT_FILENO, chunk, len);
+        if (n == -1) exit(EXIT_FAILURE);
+        bytes -= n;
+    }
+    fprintf(stderr, "generator %d done\n", getpid());
+    exit(0);
+}
+
+void child(int out[2], int err[2], const char *cmd, size_t bytes) {
+    if (dup2(out[1], STDOUT_FILENO) == -1 || dup2(err[1], STDERR_FILENO) == -1) {
+        perror("dup2");
+        exit(EXIT_FAILURE);
+    }
+    // The pipes were created O_CLOEXEC; dup2 clears it on 1 and 2 only
+    close(out[0]);
+    close(out[1]);
+    close(err[0]);
+    close(err[1]);
+
+    if (cmd == NULL) generator(bytes);
+
+    execl("/bin/sh", "sh", "-c", cmd, (char *)NULL);
+    perror("execl");
+    exit(EXIT_FAILURE);
+}
+
+void spawn(struct Collector *c, const char *cmds[], size_t bytes, bool nonblock) {
+    int flags = O_CLOEXEC | (nonblock ? O_NONBLOCK : 0);
+
+    for (size_t i = 0; i < c->n; i++) {
+        struct Child *ch = &c->children[i];
+        int out[2], err[2];
+
+        if (pipe2(out, flags) == -1 || pipe2(err, flags) == -1) {
+            perror("pipe2");
+            exit(EXIT_FAILURE);
+        }
+        // Only the read ends were meant to be non-blocking
+        if (nonblock) {
+            fcntl(out[1], F_SETFL, 0);
+            fcntl(err[1], F_SETFL, 0);
+        }
+
+        ch->cmd = cmds ? cmds[i] : NULL;
+        ch->spawned = now();
+        pid_t pid = fork();
+
+        switch (check(pid)) {
+            case PID_FAIL:
+                perror("fork");
+                exit(EXIT_FAILURE);
+            case PID_CHILD:
+                child(out, err, ch->cmd, bytes);
+                break;
+            case PID_PARENT:
+                // Closing the write ends here keeps later children from
+                // inheriting them, which would delay this child's EOF
+                close(out[1]);
+                close(err[1]);
+                ch->pid = pid;
+                ch->stream[0].fd = out[0];
+                ch->stream[1].fd = err[0];
+                ch->open = 2;
+                c->open_streams += 2;
+                break;
+        }
+    }
+}
+
+// ---- demultiplexing, shared by both backends ----
+
+void on_data(struct Collector *c, uint64_t id, const char *buf, size_t n, double t) {
+    struct Child *ch = &c->children[id >> 1];
+    struct Stream *s = &ch->stream[id & 1];
+
+    if (ch->first_byte == 0) ch->first_byte = t;
+    s->bytes += n;
+
+    if (c->keep) {
+        if (s->bytes > s->capacity) {
+            s->capacity = s->bytes * 2;
+            s->data = realloc(s->data, s->capacity);
+        }
+        memcpy(s->data + s->bytes - n, buf, n);
+    }
+}
+
+void on_eof(struct Collector *c, uint64_t id, double t) {
+    struct Child *ch = &c->children[id >> 1];
+    struct Stream *s = &ch->stream[id & 1];
+
+    close(s->fd);
+    s->fd = -1;
+    c->open_streams--;
+    if (--ch->open == 0) ch->done = t;
+}
+
+// ---- epoll backend ----
+
+int collect_epoll(struct Collector *c) {
+    int epfd = epoll_create1(EPOLL_CLOEXEC);
+    if (epfd == -1) {
+        perror("epoll_create1");
+        return -1;
+    }
+
+    for (size_t i = 0; i < c->n; i++) {
+        for (int s = 0; s < 2; s++) {
+            struct epoll_event ev = { .events = EPOLLIN, .data.u64 = tag(i, s) };
+            if (epoll_ctl(epfd, EPOLL_CTL_ADD, c->children[i].stream[s].fd, &ev) == -1) {
+                perror("epoll_ctl");
+                return -1;
+            }
+        }
+    }
+
+    static char buffer[BUFFER_SIZE];
+    struct epoll_event events[EPOLL_BATCH];
+
+    while (c->open_streams > 0) {
+        int ready = epoll_wait(epfd, events, EPOLL_BATCH, -1);
+        if (ready == -1) {
+            if (errno == EINTR) continue;
+            perror("epoll_wait");
+            return -1;
+        }
+        double t = now();
+
+        for (int e = 0; e < ready; e++) {
+            uint64_t id = events[e].data.u64;
+            int fd = c->children[id >> 1].stream[id & 1].fd;
+            if (fd == -1) continue;
+
+            // Drain what is there; EPOLLHUP also lands here and reads 0
+            for (;;) {
+                ssize_t n = read(fd, buffer, sizeof(buffer));
+                if (n > 0) {
+                    on_data(c, id, buffer, n, t);
+                    continue;
+                }
+                if (n == 0 || (errno != EAGAIN && errno != EINTR)) {
+                    if (n == -1) perror("read");
+                    // Generator children inherit earlier read ends, so close()
+                    // alone would leave the description in the epoll set
+                    epoll_ctl(epfd, EPOLL_CTL_DEL, fd, NULL);
+                    on_eof(c, id, t);
+                }
+                break;
+            }
+        }
+    }
+
+    close(epfd);
+    return 0;
+}
+
+// ---- io_uring backend (raw syscalls, no liburing) ----
+
+struct Uring {
+    int fd;
+    unsigned *sq_head, *sq_tail, *sq_mask, *sq_array;
+    unsigned *cq_head, *cq_tail, *cq_mask;
+    struct io_uring_sqe *sqes;
+    struct io_uring_cqe *cqes;
+    unsigned sq_entries;
+    unsigned pending;             // queued but not yet submitted
+    struct io_uring_buf_ring *br; // provided buffer ring
+    char *buffers;
+    bool multishot;
+};
+
+static int uring_setup(unsigned entries, struct io_uring_params *p) {
+    return syscall(__NR_io_uring_setup, entries, p);
+}
+
+static int uring_enter(int fd, unsigned submit, unsigned wait, unsigned flags) {
+    return syscall(__NR_io_uring_enter, fd, submit, wait, flags, NULL, 0);
+}
+
+static int uring_register(int fd, unsigned op, void *arg, unsigned nargs) {
+    return syscall(__NR_io_uring_register, fd, op, arg, nargs);
+}
+
+int uring_init(struct Uring *u) {
+    struct io_uring_params p;
+    memset(&p, 0, sizeof(p));
+    memset(u, 0, sizeof(*u));
+
+    u->fd = uring_setup(URING_ENTRIES, &p);
+    if (u->fd == -1) {
+        perror("io_uring_setup");
+        return -1;
+    }
+
+    size_t sq_size = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    size_t cq_size = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+    if (p.features & IORING_FEAT_SINGLE_MMAP) {
+        if (cq_size > sq_size) sq_size = cq_size;
+    }
+
+    char *sq = mmap(NULL, sq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                    u->fd, IORING_OFF_SQ_RING);
+    char *cq = sq;
+    if (!(p.features & IORING_FEAT_SINGLE_MMAP)) {
+        cq = mmap(NULL, cq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                  u->fd, IORING_OFF_CQ_RING);
+    }
+    u->sqes = mmap(NULL, p.sq_entries * sizeof(struct io_uring_sqe), PROT_READ | PROT_WRITE,
+                   MAP_SHARED | MAP_POPULATE, u->fd, IORING_OFF_SQES);
+    if (sq == MAP_FAILED || cq == MAP_FAILED || u->sqes == MAP_FAILED) {
+        perror("mmap io_uring");
+        return -1;
+    }
+
+    u->sq_head = (unsigned *)(sq + p.sq_off.head);
+    u->sq_tail = (unsigned *)(sq + p.sq_off.tail);
+    u->sq_mask = (unsigned *)(sq + p.sq_off.ring_mask);
+    u->sq_array = (unsigned *)(sq + p.sq_off.array);
+    u->cq_head = (unsigned *)(cq + p.cq_off.head);
+    u->cq_tail = (unsigned *)(cq + p.cq_off.tail);
+    u->cq_mask = (unsigned *)(cq + p.cq_off.ring_mask);
+    u->cqes = (struct io_uring_cqe *)(cq + p.cq_off.cqes);
+    u->sq_entries = p.sq_entries;
+
+    // Provided buffer ring: the kernel picks a buffer per completion
+    size_t ring_size = URING_BUFFERS * sizeof(struct io_uring_buf);
+    u->br = mmap(NULL, ring_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    u->buffers = malloc((size_t)URING_BUFFERS * BUFFER_SIZE);
+    if (u->br == MAP_FAILED || u->buffers == NULL) {
+        perror("buffer ring");
+        return -1;
+    }
+
+    struct io_uring_buf_reg reg;
+    memset(&reg, 0, sizeof(reg));
+    reg.ring_addr = (uint64_t)(uintptr_t)u->br;
+    reg.ring_entries = URING_BUFFERS;
+    reg.bgid = URING_GROUP;
+    if (uring_register(u->fd, IORING_REGISTER_PBUF_RING, &reg, 1) == -1) {
+        perror("IORING_REGISTER_PBUF_RING");
+        return -1;
+    }
+
+    for (unsigned b = 0; b < URING_BUFFERS; b++) {
+        struct io_uring_buf *buf = &u->br->bufs[b];
+        buf->addr = (uint64_t)(uintptr_t)(u->buffers + (size_t)b * BUFFER_SIZE);
+        buf->len = BUFFER_SIZE;
+        buf->bid = b;
+    }
+    atomic_store_explicit((_Atomic uint16_t *)&u->br->tail, URING_BUFFERS, memory_order_release);
+
+    // Multishot read needs Linux 6.7; older kernels get re-armed single-shot reads
+    size_t probe_size = sizeof(struct io_uring_probe) + 256 * sizeof(struct io_uring_probe_op);
+    struct io_uring_probe *probe = calloc(1, probe_size);
+    if (probe != NULL && uring_register(u->fd, IORING_REGISTER_PROBE, probe, 256) == 0) {
+        u->multishot = probe->last_op >= IORING_OP_READ_MULTISHOT &&
+                       (probe->ops[IORING_OP_READ_MULTISHOT].flags & IO_URING_OP_SUPPORTED);
+    }
+    free(probe);
+    return 0;
+}
+
+// Hand a consumed buffer back to the kernel
+void uring_recycle(struct Uring *u, uint16_t bid) {
+    uint16_t tail = u->br->tail;
+    struct io_uring_buf *buf = &u->br->bufs[tail & (URING_BUFFERS - 1)];
+    buf->addr = (uint64_t)(uintptr_t)(u->buffers + (size_t)bid * BUFFER_SIZE);
+    buf->len = BUFFER_SIZE;
+    buf->bid = bid;
+    atomic_store_explicit((_Atomic uint16_t *)&u->br->tail, tail + 1, memory_order_release);
+}
+
+struct io_uring_sqe *uring_sqe(struct Uring *u) {
+    unsigned tail = *u->sq_tail;
+    unsigned head = atomic_load_explicit((_Atomic unsigned *)u->sq_head, memory_order_acquire);
+
+    if (tail - head >= u->sq_entries) {
+        // Ring full: push what is queued to the kernel first
+        uring_enter(u->fd, u->pending, 0, 0);
+        u->pending = 0;
+    }
+
+    unsigned index = tail & *u->sq_mask;
+    struct io_uring_sqe *sqe = &u->sqes[index];
+    memset(sqe, 0, sizeof(*sqe));
+    u->sq_array[index] = index;
+    atomic_store_explicit((_Atomic unsigned *)u->sq_tail, tail + 1, memory_order_release);
+    u->pending++;
+    return sqe;
+}
+
+void uring_arm(struct Uring *u, int fd, uint64_t id) {
+    struct io_uring_sqe *sqe = uring_sqe(u);
+    sqe->opcode = u->multishot ? IORING_OP_READ_MULTISHOT : IORING_OP_READ;
+    sqe->fd = fd;
+    sqe->off = -1;                    // pipes have no offset
+    sqe->len = u->multishot ? 0 : BUFFER_SIZE;
+    sqe->flags = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = URING_GROUP;
+    sqe->user_data = id;
+}
+
+int collect_uring(struct Collector *c) {
+    struct Uring u;
+    if (uring_init(&u) == -1) return -1;
+
+    for (size_t i = 0; i < c->n; i++) {
+        for (int s = 0; s < 2; s++) {
+            uring_arm(&u, c->children[i].stream[s].fd, tag(i, s));
+        }
+    }
+
+    while (c->open_streams > 0) {
+        if (uring_enter(u.fd, u.pending, 1, IORING_ENTER_GETEVENTS) == -1 && errno != EINTR) {
+            perror("io_uring_enter");
+            // Closing the ring cancels the armed reads before anyone else reads
+            close(u.fd);
+            free(u.buffers);
+            munmap(u.br, URING_BUFFERS * sizeof(struct io_uring_buf));
+            return -1;
+        }
+        u.pending = 0;
+        double t = now();
+
+        unsigned head = *u.cq_head;
+        unsigned tail = atomic_load_explicit((_Atomic unsigned *)u.cq_tail, memory_order_acquire);
+
+        for (; head != tail; head++) {
+            struct io_uring_cqe *cqe = &u.cqes[head & *u.cq_mask];
+            uint64_t id = cqe->user_data;
+            int fd = c->children[id >> 1].stream[id & 1].fd;
+            bool more = cqe->flags & IORING_CQE_F_MORE;
+
+            if (cqe->res > 0) {
+                uint16_t bid = cqe->flags >> IORING_CQE_BUFFER_SHIFT;
+                on_data(c, id, u.buffers + (size_t)bid * BUFFER_SIZE, cqe->res, t);
+                uring_recycle(&u, bid);
+                if (!more) uring_arm(&u, fd, id);
+            } else if (cqe->res == 0) {
+                on_eof(c, id, t);
+            } else if (cqe->res == -ENOBUFS || cqe->res == -EAGAIN || cqe->res == -EINTR) {
+                if (!more) uring_arm(&u, fd, id);
+            } else {
+                fprintf(stderr, "read: %s\n", strerror(-cqe->res));
+                on_eof(c, id, t);
+            }
+        }
+        atomic_store_explicit((_Atomic unsigned *)u.cq_head, head, memory_order_release);
+    }
+
+    close(u.fd);
+    free(u.buffers);
+    munmap(u.br, URING_BUFFERS * sizeof(struct io_uring_buf));
+    return 0;
+}
+
+// ---- driver ----
+
+void reap(struct Collector *c) {
+    for (size_t i = 0; i < c->n; i++) {
+        waitpid(c->children[i].pid, &c->children[i].status, 0);
+    }
+}
+
+int collect(struct Collector *c, enum Backend b) {
+    return b == BACKEND_URING ? collect_uring(c) : collect_epoll(c);
+}
+
+// After a failed backend: close every read end still open, so children
+// blocked on a full pipe get EPIPE/SIGPIPE and exit instead of hanging reap()
+void abandon(struct Collector *c) {
+    for (size_t i = 0; i < c->n; i++) {
+        for (int s = 0; s < 2; s++) {
+            if (c->children[i].stream[s].fd == -1) continue;
+            close(c->children[i].stream[s].fd);
+            c->children[i].stream[s].fd = -1;
+        }
+        c->children[i].open = 0;
+    }
+    c->open_streams = 0;
+}
+
+// Finish with epoll what another backend could not; the read ends were
+// opened blocking for io_uring
+int collect_fallback(struct Collector *c) {
+    for (size_t i = 0; i < c->n; i++) {
+        for (int s = 0; s < 2; s++) {
+            int fd = c->children[i].stream[s].fd;
+            if (fd != -1) fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+        }
+    }
+    return collect_epoll(c);
+}
+
+static int compare_double(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+void report(struct Collector *c, enum Backend b, double wall) {
+    double *first = malloc(c->n * sizeof(double));
+    double *done = malloc(c->n * sizeof(double));
+    size_t bytes = 0;
+
+    for (size_t i = 0; i < c->n; i++) {
+        struct Child *ch = &c->children[i];
+        bytes += ch->stream[0].bytes + ch->stream[1].bytes;
+        first[i] = (ch->first_byte - ch->spawned) * 1e3;
+        done[i] = (ch->done - ch->spawned) * 1e3;
+    }
+    qsort(first, c->n, sizeof(double), compare_double);
+    qsort(done, c->n, sizeof(double), compare_double);
+
+    size_t p99 = (c->n * 99) / 100;
+    printf("%-6s %6zu %10.1f %9.3f %9.3f %9.3f %9.3f %9.3f\n",
+           backend_names[b], c->n, bytes / wall / (1 << 20),
+           first[c->n / 2], first[p99], done[c->n / 2], done[p99], done[c->n - 1]);
+
+    free(first);
+    free(done);
+}
+
+void dump(struct Collector *c) {
+    const char *names[] = { "stdout", "stderr" };
+
+    for (size_t i = 0; i < c->n; i++) {
+        struct Child *ch = &c->children[i];
+        printf("==> [%zu] %s (pid %d, exit %d)\n", i, ch->cmd, ch->pid,
+               WIFEXITED(ch->status) ? WEXITSTATUS(ch->status) : -1);
+        for (int s = 0; s < 2; s++) {
+            if (ch->stream[s].bytes == 0) continue;
+            printf("--- %s, %zu bytes\n", names[s], ch->stream[s].bytes);
+            fwrite(ch->stream[s].data, 1, ch->stream[s].bytes, stdout);
+        }
+    }
+}
+
+void collector_free(struct Collector *c) {
+    for (size_t i = 0; i < c->n; i++) {
+        free(c->children[i].stream[0].data);
+        free(c->children[i].stream[1].data);
+    }
+    free(c->children);
+}
+
+void bench(size_t kib) {
+    size_t counts[] = { 1, 64, 1024 };
+
+    printf("%zu KiB per child; latencies in ms from fork\n", kib);
+    printf("%-6s %6s %10s %9s %9s %9s %9s %9s\n", "", "N", "MiB/s",
+           "first50", "first99", "done50", "done99", "donemax");
+
+    for (size_t k = 0; k < sizeof(counts) / sizeof(counts[0]); k++) {
+        for (int b = BACKEND_EPOLL; b <= BACKEND_URING; b++) {
+            struct Collector c = { calloc(counts[k], sizeof(struct Child)), counts[k], 0, false };
+
+            fflush(stdout);
+            double start = now();
+            spawn(&c, NULL, kib << 10, b == BACKEND_EPOLL);
+            int rc = collect(&c, b);
+            double wall = now() - start;
+            if (rc == -1) abandon(&c);
+            reap(&c);
+
+            if (rc == 0) report(&c, b, wall);
+            else printf("%-6s %6zu unavailable\n", backend_names[b], counts[k]);
+            collector_free(&c);
+        }
+    }
+}
+
+int main(int argc, char *argv[]) {
+    // Two pipes per child: lift the soft descriptor limit as far as allowed
+    struct rlimit rl;
+    if (getrlimit(RLIMIT_NOFILE, &rl) == 0) {
+        rl.rlim_cur = rl.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &rl);
+    }
+
+    if (argc > 1 && strcmp(argv[1], "bench") == 0) {
+        bench(argc > 2 ? strtoull(argv[2], NULL, 10) : 256);
+        return 0;
+    }
+
+    if (argc < 3 || (strcmp(argv[1], "epoll") != 0 && strcmp(argv[1], "uring") != 0)) {
+        fprintf(stderr, "usage: %s epoll|uring \"cmd 1\" \"cmd 2\" ...\n"
+                        "       %s bench [KiB per child]\n", argv[0], argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    enum Backend b = strcmp(argv[1], "uring") == 0 ? BACKEND_URING : BACKEND_EPOLL;
+    struct Collector c = { calloc(argc - 2, sizeof(struct Child)), argc - 2, 0, true };
+
+    spawn(&c, (const char **)&argv[2], 0, b == BACKEND_EPOLL);
+    int rc = collect(&c, b);
+    if (rc == -1 && b == BACKEND_URING) {
+        fprintf(stderr, "io_uring unavailable, collecting the rest with epoll\n");
+        rc = collect_fallback(&c);
+    }
+    if (rc == -1) abandon(&c);
+    reap(&c);
+    dump(&c);
+    collector_free(&c);
+
+    return rc == 0 ? 0 : EXIT_FAILURE;
+}
@@ -0,0 +1,425 @@
+// Shell-style N-stage pipeline: cmd1 | cmd2 | ... | cmdN
+//
+// Extends the single ls -l child of tarefa4/c06 to N concurrent stages. Every
+// stage gets its stdin/stdout wired with dup2 and all other pipe ends closed,
+// otherwise a reader never sees EOF. Stages are reaped through pidfds: each
+// pidfd becomes readable when its process exits, and wait4() then returns the
+// exit status together with that stage's rusage.
+//
+// With -s the runner sits in every link itself: stage i writes to one pipe,
+// stage i+1 reads another, and the runner splice()s between the two, counting
+// the bytes that flow through each link.
+//
+// Usage: ./fork_pipeline [-s] 'cmd1 | cmd2 | ... | cmdN'
+//        ./fork_pipeline bench [repetitions]
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/pidfd.h>
+#include <sys/resource.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+#define MAX_STAGES 32
+#define MAX_ARGS 64
+#define SPLICE_CHUNK (1 << 16)
+
+enum PID {
+    PID_PARENT,
+    PID_CHILD,
+    PID_FAIL,
+};
+
+enum PID check(pid_t pid) {
+    if (pid == 0) {
+        return PID_CHILD;
+    } else if (pid > 0) {
+        return PID_PARENT;
+    }
+    return PID_FAIL;
+}
+
+struct Stage {
+    char *argv[MAX_ARGS];
+    pid_t pid;
+    int pidfd;            // -1 once reaped
+    int status;
+    struct rusage usage;
+    double started;       // just before its fork
+    double finished;
+};
+
+// A link the runner splices: from stage i's stdout into stage i+1's stdin
+struct Link {
+    int from;             // read end, -1 once EOF
+    int to;               // write end, -1 once closed
+    bool blocked;         // last splice hit a full destination pipe
+    size_t bytes;
+};
+
+struct Pipeline {
+    struct Stage stages[MAX_STAGES];
+    struct Link links[MAX_STAGES - 1];
+    int n;
+    bool splice_links;
+};
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Split "a b | c 'd e'" into stages; words are unquoted in place
+int parse(struct Pipeline *p, char *line) {
+    int argc = 0;
+    bool in_word = false;
+    char quote = 0;
+    char *w = line;
+
+    p->n = 1;
+    for (char *c = line;; c++) {
+        char ch = *c;
+
+        if (ch != '\0' && !quote && (ch == '\'' || ch == '"')) {
+            quote = ch;
+        } else if (ch != '\0' && quote && ch == quote) {
+            quote = 0;
+        } else if (ch != '\0' && (quote || (ch != ' ' && ch != '\t' && ch != '|'))) {
+            if (!in_word) {
+                if (argc == MAX_ARGS - 1) return -1;
+                p->stages[p->n - 1].argv[argc++] = w;
+                in_word = true;
+            }
+            *w++ = ch;
+            continue;
+        } else {
+            if (in_word) *w++ = '\0';
+            in_word = false;
+        }
+
+        if (ch == '|') {
+            if (argc == 0 || p->n == MAX_STAGES) return -1;
+            p->stages[p->n - 1].argv[argc] = NULL;
+            p->n++;
+            argc = 0;
+        }
+        if (ch == '\0') break;
+    }
+
+    if (argc == 0) return -1;
+    p->stages[p->n - 1].argv[argc] = NULL;
+    return 0;
+}
+
+// Wire stdin/stdout and close every pipe end the stage does not use.
+// Link s is fds[2s] in direct mode; in splice mode stage s writes fds[2s]
+// and stage s+1 reads fds[2s+1], with the runner in between.
+void stage(struct Pipeline *p, int s, int fds[][2]) {
+    int step = p->splice_links ? 2 : 1;
+    int in = s > 0 ? fds[2 * (s - 1) + step - 1][0] : -1;
+    int out = s < p->n - 1 ? fds[2 * s][1] : -1;
+
+    // The runner ignores SIGPIPE, and exec keeps ignored signals ignored;
+    // a stage writing to a closed pipe must die of it as under a shell
+    signal(SIGPIPE, SIG_DFL);
+
+    if ((in != -1 && dup2(in, STDIN_FILENO) == -1) ||
+        (out != -1 && dup2(out, STDOUT_FILENO) == -1)) {
+        perror("dup2");
+        exit(EXIT_FAILURE);
+    }
+    for (int l = 0; l < p->n - 1; l++) {
+        for (int k = 0; k < step; k++) {
+            close(fds[2 * l + k][0]);
+            close(fds[2 * l + k][1]);
+        }
+    }
+
+    execvp(p->stages[s].argv[0], p->stages[s].argv);
+    perror(p->stages[s].argv[0]);
+    exit(127);
+}
+
+// Reap a stage whose pidfd became readable
+void reap(struct Stage *st, double t) {
+    wait4(st->pid, &st->status, 0, &st->usage);
+    st->finished = t;
+    close(st->pidfd);
+    st->pidfd = -1;
+}
+
+void link_close(struct Link *l) {
+    if (l->from != -1) close(l->from);
+    if (l->to != -1) close(l->to);
+    l->from = l->to = -1;
+}
+
+// Move what is available on one link without blocking the runner
+void link_pump(struct Link *l) {
+    for (;;) {
+        ssize_t n = splice(l->from, NULL, l->to, NULL, SPLICE_CHUNK,
+                           SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+        if (n > 0) {
+            l->bytes += n;
+            l->blocked = false;
+            continue;
+        }
+        if (n == 0) {
+            // Writer is gone: closing our write end passes EOF downstream
+            link_close(l);
+        } else if (errno == EAGAIN) {
+            // Either nothing to read or no room to write; ask poll which
+            int room = 0;
+            struct pollfd out = { l->to, POLLOUT, 0 };
+            if (poll(&out, 1, 0) == 1 && (out.revents & POLLOUT)) room = 1;
+            l->blocked = !room;
+        } else {
+            // EPIPE: the reader exited early (e.g. head). SIGPIPE is ignored
+            // in the runner, so this is reported here instead of killing it
+            link_close(l);
+        }
+        return;
+    }
+}
+
+// Undo a run() that failed partway: kill and reap the first forked stages
+// and close every pipe end the runner still holds
+void abandon(struct Pipeline *p, int forked, int fds[][2]) {
+    for (int s = 0; s < forked; s++) {
+        struct Stage *st = &p->stages[s];
+        kill(st->pid, SIGKILL);
+        waitpid(st->pid, &st->status, 0);
+        if (st->pidfd != -1) close(st->pidfd);
+        st->pidfd = -1;
+    }
+    for (int k = 0; k < 2 * MAX_STAGES; k++) {
+        if (fds[k][0] != -1) close(fds[k][0]);
+        if (fds[k][1] != -1) close(fds[k][1]);
+    }
+}
+
+int run(struct Pipeline *p) {
+    // Direct mode: one pipe per link. Splice mode: two pipes per link.
+    int fds[2 * MAX_STAGES][2];
+    for (int k = 0; k < 2 * MAX_STAGES; k++) fds[k][0] = fds[k][1] = -1;
+
+    // A splice into a link whose reader is gone must fail with EPIPE, not
+    // kill the runner before it reaps and reports
+    void (*saved_sigpipe)(int) = signal(SIGPIPE, SIG_IGN);
+
+    for (int s = 0; s < p->n - 1; s++) {
+        if (pipe2(fds[2 * s], O_CLOEXEC) == -1 ||
+            (p->splice_links && pipe2(fds[2 * s + 1], O_CLOEXEC) == -1)) {
+            perror("pipe2");
+            abandon(p, 0, fds);
+            signal(SIGPIPE, saved_sigpipe);
+            return -1;
+        }
+    }
+
+    fflush(stdout);
+    for (int s = 0; s < p->n; s++) {
+        struct Stage *st = &p->stages[s];
+        st->started = now();
+        pid_t pid = fork();
+
+        switch (check(pid)) {
+            case PID_FAIL:
+                perror("fork");
+                abandon(p, s, fds);
+                signal(SIGPIPE, saved_sigpipe);
+                return -1;
+            case PID_CHILD:
+                stage(p, s, fds);
+                break;
+            case PID_PARENT:
+                st->pid = pid;
+                st->pidfd = pidfd_open(pid, 0);
+                if (st->pidfd == -1) {
+                    perror("pidfd_open");
+                    abandon(p, s + 1, fds);
+                    signal(SIGPIPE, saved_sigpipe);
+                    return -1;
+                }
+                break;
+        }
+    }
+
+    // All stages are running; the runner keeps only the ends it splices
+    for (int s = 0; s < p->n - 1; s++) {
+        struct Link *l = &p->links[s];
+        if (p->splice_links) {
+            close(fds[2 * s][1]);
+            close(fds[2 * s + 1][0]);
+            l->from = fds[2 * s][0];
+            l->to = fds[2 * s + 1][1];
+            fcntl(l->from, F_SETFL, O_NONBLOCK);
+            fcntl(l->to, F_SETFL, O_NONBLOCK);
+        } else {
+            close(fds[2 * s][0]);
+            close(fds[2 * s][1]);
+            l->from = l->to = -1;
+        }
+        l->blocked = false;
+        l->bytes = 0;
+    }
+
+    int running = p->n;
+    while (running > 0) {
+        struct pollfd pfd[2 * MAX_STAGES];
+        int who[2 * MAX_STAGES];     // >= 0 stage, < 0 link (-1 - index)
+        int npfd = 0;
+
+        for (int s = 0; s < p->n; s++) {
+            if (p->stages[s].pidfd == -1) continue;
+            pfd[npfd] = (struct pollfd){ p->stages[s].pidfd, POLLIN, 0 };
+            who[npfd++] = s;
+        }
+        for (int s = 0; s < p->n - 1; s++) {
+            struct Link *l = &p->links[s];
+            if (l->from == -1) continue;
+            pfd[npfd] = l->blocked ? (struct pollfd){ l->to, POLLOUT, 0 }
+                                   : (struct pollfd){ l->from, POLLIN, 0 };
+            who[npfd++] = -1 - s;
+        }
+
+        if (poll(pfd, npfd, -1) == -1) {
+            if (errno == EINTR) continue;
+            perror("poll");
+            signal(SIGPIPE, saved_sigpipe);
+            return -1;
+        }
+        double t = now();
+
+        for (int i = 0; i < npfd; i++) {
+            if (!pfd[i].revents) continue;
+            if (who[i] >= 0) {
+                reap(&p->stages[who[i]], t);
+                running--;
+            } else {
+                link_pump(&p->links[-1 - who[i]]);
+            }
+        }
+    }
+
+    for (int s = 0; s < p->n - 1; s++) link_close(&p->links[s]);
+    signal(SIGPIPE, saved_sigpipe);
+    return 0;
+}
+
+static double tv(struct timeval t) {
+    return t.tv_sec + t.tv_usec / 1e6;
+}
+
+void report(struct Pipeline *p, double started) {
+    fprintf(stderr, "%-5s %-8s %-6s %10s %10s %10s %10s %10s %12s  %s\n",
+            "stage", "pid", "exit", "start(ms)", "wall(ms)", "user(ms)", "sys(ms)", "maxrss(K)",
+            p->splice_links ? "bytes out" : "", "command");
+    for (int s = 0; s < p->n; s++) {
+        struct Stage *st = &p->stages[s];
+        int code = WIFEXITED(st->status) ? WEXITSTATUS(st->status) : 128 + WTERMSIG(st->status);
+        char bytes[32] = "";
+        if (p->splice_links && s < p->n - 1) snprintf(bytes, sizeof(bytes), "%zu", p->links[s].bytes);
+        fprintf(stderr, "%-5d %-8d %-6d %10.3f %10.2f %10.2f %10.2f %10ld %12s  %s\n",
+                s, st->pid, code, (st->started - started) * 1e3, (st->finished - st->started) * 1e3,
+                tv(st->usage.ru_utime) * 1e3, tv(st->usage.ru_stime) * 1e3,
+                st->usage.ru_maxrss, bytes, st->argv[0]);
+    }
+}
+
+// Time one /bin/sh -c run of the same command line
+double run_shell(const char *line) {
+    double start = now();
+    fflush(stdout);
+    pid_t pid = fork();
+
+    switch (check(pid)) {
+        case PID_FAIL:
+            perror("fork");
+            exit(EXIT_FAILURE);
+        case PID_CHILD:
+            execl("/bin/sh", "sh", "-c", line, (char *)NULL);
+            perror("execl");
+            exit(127);
+        case PID_PARENT:
+            waitpid(pid, NULL, 0);
+            break;
+    }
+    return now() - start;
+}
+
+double run_runner(const char *line, bool splice_links) {
+    struct Pipeline p;
+    char copy[1024];
+    snprintf(copy, sizeof(copy), "%s", line);
+    memset(&p, 0, sizeof(p));
+    p.splice_links = splice_links;
+    if (parse(&p, copy) == -1) exit(EXIT_FAILURE);
+
+    double start = now();
+    run(&p);
+    return now() - start;
+}
+
+void bench(int repetitions) {
+    const char *line = "seq 1 2000000 | sed s/1/one/ | grep -v 7 | tr a-z A-Z | wc -l";
+
+    // Only wc writes to stdout; send it to /dev/null for every contender
+    int saved = dup(STDOUT_FILENO);
+    int devnull = open("/dev/null", O_WRONLY);
+    dup2(devnull, STDOUT_FILENO);
+    close(devnull);
+
+    double shell = 0, direct = 0, spliced = 0;
+    for (int r = 0; r < repetitions; r++) {
+        shell += run_shell(line);
+        direct += run_runner(line, false);
+        spliced += run_runner(line, true);
+    }
+
+    dup2(saved, STDOUT_FILENO);
+    close(saved);
+
+    printf("%s\n%d repetitions, mean wall time\n", line, repetitions);
+    printf("%-16s %10.2f ms\n", "/bin/sh -c", shell / repetitions * 1e3);
+    printf("%-16s %10.2f ms\n", "runner", direct / repetitions * 1e3);
+    printf("%-16s %10.2f ms\n", "runner -s", spliced / repetitions * 1e3);
+}
+
+int main(int argc, char *argv[]) {
+    if (argc > 1 && strcmp(argv[1], "bench") == 0) {
+        bench(argc > 2 ? atoi(argv[2]) : 10);
+        return 0;
+    }
+
+    struct Pipeline p;
+    memset(&p, 0, sizeof(p));
+
+    int a = 1;
+    if (a < argc && strcmp(argv[a], "-s") == 0) {
+        p.splice_links = true;
+        a++;
+    }
+    if (a >= argc || parse(&p, argv[a]) == -1) {
+        fprintf(stderr, "usage: %s [-s] 'cmd1 | cmd2 | ... | cmdN'\n"
+                        "       %s bench [repetitions]\n", argv[0], argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    double start = now();
+    if (run(&p) == -1) return EXIT_FAILURE;
+    report(&p, start);
+
+    // Like a shell, the pipeline's status is the last stage's
+    int last = p.stages[p.n - 1].status;
+    return WIFEXITED(last) ? WEXITSTATUS(last) : 128 + WTERMSIG(last);
+}
@@ -0,0 +1,313 @@
+// Spawning a program without copying the parent's address space.
+//
+// fork() + execve() (c04_execve, tarefa6 shell()) duplicates the parent's
+// page tables and marks every page copy-on-write, only for execve() to throw
+// it all away; the cost grows with the parent's RSS. The backends below let
+// the child borrow the parent's memory until it execs instead:
+//
+//   fork     fork() + dup2() + execve(), the baseline
+//   posix    posix_spawn() with file actions
+//   vfork    vfork() + dup2() + execve()
+//   clone3   raw clone3(CLONE_VM | CLONE_VFORK) on a private child stack
+//
+// Every backend applies the same redirection actions (dup2/close) before the
+// exec, so the fork_pipe.c pattern of pointing stdout at a pipe still works.
+//
+// Usage: ./fast_spawn fork|posix|vfork|clone3 cmd args...
+//        ./fast_spawn bench [spawns per point]
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sched.h>
+#include <signal.h>
+#include <spawn.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <linux/sched.h>
+
+extern char **environ;
+
+#define CHILD_STACK (64 * 1024)
+
+enum SpawnBackend {
+    SPAWN_FORK,
+    SPAWN_POSIX,
+    SPAWN_VFORK,
+    SPAWN_CLONE3,
+};
+
+const char *spawn_names[] = { "fork", "posix", "vfork", "clone3" };
+
+// dup2(fd, target), or close(target) when fd is -1
+struct SpawnAction {
+    int fd;
+    int target;
+};
+
+// Everything the child needs; with CLONE_VM it is read from the parent's
+// memory, and error is written straight back into it
+struct SpawnRequest {
+    const char *path;
+    char *const *argv;
+    char *const *envp;
+    const struct SpawnAction *actions;
+    size_t nactions;
+    volatile int error;
+};
+
+// Runs in the child. Only async-signal-safe calls: with vfork/clone3 this
+// executes on borrowed memory while the parent is suspended.
+static int spawn_child(void *arg) {
+    struct SpawnRequest *r = arg;
+
+    for (size_t a = 0; a < r->nactions; a++) {
+        const struct SpawnAction *act = &r->actions[a];
+        int rc = act->fd == -1 ? close(act->target) : dup2(act->fd, act->target);
+        if (rc == -1) {
+            r->error = errno;
+            _exit(127);
+        }
+    }
+    execve(r->path, r->argv, r->envp);
+    r->error = errno;
+    _exit(127);
+}
+
+#if defined(__x86_64__)
+// glibc has no clone3() wrapper that runs a function: the child starts on the
+// new stack with no frame to return into, so it must call fn and exit itself
+static pid_t clone3_run(struct clone_args *args, int (*fn)(void *), void *arg) {
+    register long rax __asm__("rax") = SYS_clone3;
+    register void *r12 __asm__("r12") = (void *)fn;
+    register void *r13 __asm__("r13") = arg;
+
+    __asm__ volatile(
+        "syscall\n\t"
+        "test %%rax, %%rax\n\t"
+        "jnz 1f\n\t"
+        // child: fresh 16-byte aligned stack, no frame above us
+        "xor %%ebp, %%ebp\n\t"
+        "mov %%r13, %%rdi\n\t"
+        "call *%%r12\n\t"
+        "mov %%eax, %%edi\n\t"
+        "mov %[exit], %%eax\n\t"
+        "syscall\n\t"
+        "hlt\n\t"
+        "1:\n\t"
+        : "+r"(rax)
+        : "D"(args), "S"(sizeof(*args)), "r"(r12), "r"(r13), [exit] "i"(SYS_exit)
+        : "rcx", "r11", "memory");
+
+    if (rax < 0) {
+        errno = -rax;
+        return -1;
+    }
+    return rax;
+}
+#endif
+
+pid_t spawn_clone3(struct SpawnRequest *r) {
+    static char *stack = NULL;
+    if (stack == NULL) {
+        // CLONE_VFORK suspends us until exec, so one stack serves every spawn
+        stack = mmap(NULL, CHILD_STACK, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS | MAP_STACK, -1, 0);
+        if (stack == MAP_FAILED) {
+            stack = NULL;
+            return -1;
+        }
+    }
+
+#if defined(__x86_64__)
+    struct clone_args args;
+    memset(&args, 0, sizeof(args));
+    args.flags = CLONE_VM | CLONE_VFORK;
+    args.exit_signal = SIGCHLD;
+    args.stack = (uint64_t)(uintptr_t)stack;
+    args.stack_size = CHILD_STACK;
+    return clone3_run(&args, spawn_child, r);
+#else
+    return clone(spawn_child, stack + CHILD_STACK, CLONE_VM | CLONE_VFORK | SIGCHLD, r);
+#endif
+}
+
+pid_t spawn_posix(struct SpawnRequest *r) {
+    posix_spawn_file_actions_t fa;
+    posix_spawn_file_actions_init(&fa);
+    for (size_t a = 0; a < r->nactions; a++) {
+        if (r->actions[a].fd == -1) posix_spawn_file_actions_addclose(&fa, r->actions[a].target);
+        else posix_spawn_file_actions_adddup2(&fa, r->actions[a].fd, r->actions[a].target);
+    }
+
+    pid_t pid;
+    int rc = posix_spawn(&pid, r->path, &fa, NULL, r->argv, r->envp);
+    posix_spawn_file_actions_destroy(&fa);
+    if (rc != 0) {
+        errno = rc;
+        return -1;
+    }
+    return pid;
+}
+
+// Returns the child's pid, or -1 with errno set (including exec failures
+// for the vfork-style backends, which see the child's errno directly)
+pid_t spawn(enum SpawnBackend b, const char *path, char *const argv[], char *const envp[],
+            const struct SpawnAction *actions, size_t nactions) {
+    struct SpawnRequest r = { path, argv, envp, actions, nactions, 0 };
+    pid_t pid = -1;
+
+    switch (b) {
+        case SPAWN_FORK:
+            pid = fork();
+            if (pid == 0) spawn_child(&r);
+            break;
+        case SPAWN_POSIX:
+            return spawn_posix(&r);
+        case SPAWN_VFORK:
+            pid = vfork();
+            if (pid == 0) spawn_child(&r);
+            break;
+        case SPAWN_CLONE3:
+            pid = spawn_clone3(&r);
+            break;
+    }
+
+    if (pid > 0 && r.error != 0) {
+        waitpid(pid, NULL, 0);
+        errno = r.error;
+        return -1;
+    }
+    return pid;
+}
+
+// ---- benchmark ----
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+size_t mem_available(void) {
+    FILE *f = fopen("/proc/meminfo", "r");
+    char line[128];
+    size_t kib = 0;
+    while (f && fgets(line, sizeof(line), f)) {
+        if (sscanf(line, "MemAvailable: %zu kB", &kib) == 1) break;
+    }
+    if (f) fclose(f);
+    return kib << 10;
+}
+
+void bench(int spawns) {
+    size_t sizes[] = { 10ul << 20, 100ul << 20, 1ul << 30, 4ul << 30, 8ul << 30 };
+    char *argv[] = { "/bin/true", NULL };
+    int devnull = open("/dev/null", O_WRONLY);
+    struct SpawnAction actions[] = { { devnull, STDOUT_FILENO }, { -1, STDIN_FILENO } };
+
+    printf("spawns/s of /bin/true (stdout -> /dev/null), %d spawns per point\n", spawns);
+    printf("%10s", "RSS");
+    for (int b = SPAWN_FORK; b <= SPAWN_CLONE3; b++) printf(" %10s", spawn_names[b]);
+    printf("\n");
+
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+        if (sizes[s] > mem_available() * 8 / 10) {
+            printf("%9zuM skipped: not enough free memory\n", sizes[s] >> 20);
+            continue;
+        }
+        // Touch every page so the parent really has this RSS to copy
+        char *ballast = mmap(NULL, sizes[s], PROT_READ | PROT_WRITE,
+                             MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE, -1, 0);
+        if (ballast == MAP_FAILED) {
+            printf("%9zuM skipped: %s\n", sizes[s] >> 20, strerror(errno));
+            continue;
+        }
+        memset(ballast, 1, sizes[s]);
+
+        printf("%9zuM", sizes[s] >> 20);
+        for (int b = SPAWN_FORK; b <= SPAWN_CLONE3; b++) {
+            // fork gets slow with big parents; keep each point bounded
+            int n = b == SPAWN_FORK && sizes[s] >= (1ul << 30) ? spawns / 10 + 1 : spawns;
+            double start = now();
+            for (int i = 0; i < n; i++) {
+                pid_t pid = spawn(b, argv[0], argv, environ, actions, 2);
+                if (pid == -1) {
+                    perror(spawn_names[b]);
+                    break;
+                }
+                waitpid(pid, NULL, 0);
+            }
+            printf(" %10.0f", n / (now() - start));
+            fflush(stdout);
+        }
+        printf("\n");
+        munmap(ballast, sizes[s]);
+    }
+    close(devnull);
+}
+
+int main(int argc, char *argv[]) {
+    if (argc > 1 && strcmp(argv[1], "bench") == 0) {
+        bench(argc > 2 ? atoi(argv[2]) : 2000);
+        return 0;
+    }
+
+    int b = -1;
+    for (int k = SPAWN_FORK; argc > 2 && k <= SPAWN_CLONE3; k++) {
+        if (strcmp(argv[1], spawn_names[k]) == 0) b = k;
+    }
+    if (b == -1) {
+        fprintf(stderr, "usage: %s fork|posix|vfork|clone3 cmd args...\n"
+                        "       %s bench [spawns per point]\n", argv[0], argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    // Same shape as fork_pipe.c: the child's stdout goes into a pipe we read
+    int pipe_fd[2];
+    if (pipe2(pipe_fd, O_CLOEXEC) == -1) {
+        perror("pipe2");
+        return EXIT_FAILURE;
+    }
+
+    // execve needs a path; resolve argv[2] the way execvp would
+    char path[4096];
+    snprintf(path, sizeof(path), "%s", argv[2]);
+    if (strchr(argv[2], '/') == NULL) {
+        char *dirs = strdup(getenv("PATH") ? getenv("PATH") : "/usr/bin:/bin");
+        for (char *d = strtok(dirs, ":"); d; d = strtok(NULL, ":")) {
+            snprintf(path, sizeof(path), "%s/%s", d, argv[2]);
+            if (access(path, X_OK) == 0) break;
+        }
+        free(dirs);
+    }
+
+    struct SpawnAction actions[] = { { pipe_fd[1], STDOUT_FILENO } };
+    pid_t pid = spawn(b, path, &argv[2], environ, actions, 1);
+    close(pipe_fd[1]);
+    if (pid == -1) {
+        perror(argv[2]);
+        return EXIT_FAILURE;
+    }
+
+    printf("Output from child %d (%s):\n------------------\n", pid, spawn_names[b]);
+    fflush(stdout);
+    char buffer[4096];
+    ssize_t n;
+    while ((n = read(pipe_fd[0], buffer, sizeof(buffer))) > 0) {
+        fwrite(buffer, 1, n, stdout);
+    }
+    printf("------------------\n");
+
+    int status;
+    waitpid(pid, &status, 0);
+    printf("Child process exited with status %d\n", WIFEXITED(status) ? WEXITSTATUS(status) : -1);
+    return 0;
+}
@@ -0,0 +1,296 @@
+// Process and thread creation cost, measured in-process.
+//
+// The sequence/wait targets in ../Makefile run a binary 333 times from a shell
+// loop, which mostly measures the shell. Here one driver creates and reaps N
+// children back to back with each mechanism and records, per creation:
+//
+//   create   time until the creating call returns in the parent
+//   start    time until the child/thread runs its first line
+//   faults   minor page faults taken by the parent and by the child
+//
+// Three sweeps vary one factor at a time: parent heap size (RSS the kernel
+// has to mark copy-on-write), pages the child writes after creation, and the
+// number of idle threads in the parent.
+//
+// Usage: ./creation_bench [N]
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include <signal.h>
+#include <spawn.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <linux/sched.h>
+
+extern char **environ;
+
+enum Mechanism {
+    MECH_FORK,
+    MECH_VFORK,
+    MECH_CLONE3,
+    MECH_PTHREAD,
+    MECH_SPAWN,
+};
+
+const char *mech_names[] = { "fork", "vfork", "clone3", "pthread", "posix_spawn" };
+
+// Written by the child, read by the parent after reaping
+struct Slot {
+    _Atomic uint64_t start_ns;
+    long minflt;
+};
+
+struct Config {
+    size_t heap;          // bytes of touched parent heap
+    size_t touch;         // pages the child writes
+    int threads;          // idle threads in the parent
+};
+
+static char *heap;
+static size_t heap_size;
+static size_t touch_pages;
+static struct Slot *slot;
+static long page_size;
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static size_t mem_available(void) {
+    FILE *f = fopen("/proc/meminfo", "r");
+    char line[128];
+    size_t kib = 0;
+    while (f && fgets(line, sizeof(line), f)) {
+        if (sscanf(line, "MemAvailable: %zu kB", &kib) == 1) break;
+    }
+    if (f) fclose(f);
+    return kib << 10;
+}
+
+static long minflt(int who) {
+    struct rusage ru;
+    getrusage(who, &ru);
+    return ru.ru_minflt;
+}
+
+// First thing every child/thread does; then dirty the requested pages
+static void child_body(int who) {
+    atomic_store(&slot->start_ns, now_ns());
+    for (size_t p = 0; p < touch_pages && p * page_size < heap_size; p++) {
+        heap[p * page_size]++;
+    }
+    slot->minflt = minflt(who);
+}
+
+static void *thread_body(void *arg) {
+    (void)arg;
+    child_body(RUSAGE_THREAD);
+    return NULL;
+}
+
+static void *idle_thread(void *arg) {
+    (void)arg;
+    pause();
+    return NULL;
+}
+
+// One creation + reap, filling in the create and start latencies and the
+// child's faults; -1 when the creation failed
+int create_one(enum Mechanism m, uint64_t *create, uint64_t *start, long *child_faults) {
+    char *argv[] = { "/bin/true", NULL };
+    struct rusage ru;
+    pthread_t th;
+    pid_t pid = -1;
+    int err;
+
+    *create = *start = 0;
+    *child_faults = 0;
+    atomic_store(&slot->start_ns, 0);
+    slot->minflt = 0;
+    uint64_t t0 = now_ns();
+
+    switch (m) {
+        case MECH_FORK:
+            pid = fork();
+            if (pid == 0) {
+                child_body(RUSAGE_SELF);
+                _exit(0);
+            }
+            break;
+        case MECH_VFORK:
+            // The child borrows our memory: its writes land in our heap
+            pid = vfork();
+            if (pid == 0) {
+                child_body(RUSAGE_SELF);
+                _exit(0);
+            }
+            break;
+        case MECH_CLONE3: {
+            // Without CLONE_VM the child returns here on a copy of our stack
+            struct clone_args args;
+            memset(&args, 0, sizeof(args));
+            args.exit_signal = SIGCHLD;
+            pid = syscall(SYS_clone3, &args, sizeof(args));
+            if (pid == 0) {
+                child_body(RUSAGE_SELF);
+                _exit(0);
+            }
+            break;
+        }
+        case MECH_PTHREAD:
+            err = pthread_create(&th, NULL, thread_body, NULL);
+            if (err != 0) {
+                fprintf(stderr, "pthread_create: %s\n", strerror(err));
+                return -1;
+            }
+            break;
+        case MECH_SPAWN:
+            if (posix_spawn(&pid, argv[0], NULL, NULL, argv, environ) != 0) pid = -1;
+            break;
+    }
+
+    uint64_t created = now_ns() - t0;
+
+    if (m == MECH_PTHREAD) {
+        pthread_join(th, NULL);
+        *child_faults = slot->minflt;
+    } else if (pid > 0) {
+        wait4(pid, NULL, 0, &ru);
+        *child_faults = ru.ru_minflt;
+    } else {
+        perror(mech_names[m]);
+        return -1;
+    }
+
+    uint64_t s = atomic_load(&slot->start_ns);
+    *create = created;
+    *start = s ? s - t0 : 0;   // posix_spawn runs /bin/true, no start stamp
+    return 0;
+}
+
+static int compare_u64(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+// Percentile of a sorted array, in microseconds
+static double pct(uint64_t *v, int n, int p) {
+    int i = (int)((long)n * p / 100);
+    return v[i < n ? i : n - 1] / 1e3;
+}
+
+void measure(const char *label, enum Mechanism m, int n) {
+    uint64_t *create = malloc(n * sizeof(uint64_t));
+    uint64_t *start = malloc(n * sizeof(uint64_t));
+    long child_faults = 0;
+    int ok = 0;                 // creations that worked; failed ones are left out
+
+    long before = minflt(RUSAGE_SELF);
+    for (int i = 0; i < n; i++) {
+        long f;
+        if (create_one(m, &create[ok], &start[ok], &f) == -1) continue;
+        child_faults += f;
+        ok++;
+    }
+    long parent_faults = minflt(RUSAGE_SELF) - before;
+    if (m == MECH_PTHREAD) parent_faults -= child_faults;   // same process
+
+    if (ok == 0) {
+        printf("%-22s %-12s every creation failed\n", label, mech_names[m]);
+    } else {
+        qsort(create, ok, sizeof(uint64_t), compare_u64);
+        qsort(start, ok, sizeof(uint64_t), compare_u64);
+
+        printf("%-22s %-12s %9.1f %9.1f %9.1f %9.1f %9.1f %9.1f %9.1f",
+               label, mech_names[m],
+               pct(create, ok, 50), pct(create, ok, 99), pct(create, ok, 100),
+               pct(start, ok, 50), pct(start, ok, 99),
+               (double)parent_faults / ok, (double)child_faults / ok);
+        if (ok < n) printf("  (%d of %d failed)", n - ok, n);
+        printf("\n");
+    }
+
+    free(create);
+    free(start);
+}
+
+void sweep_point(const char *label, struct Config c, int n) {
+    // Heap of the requested size, every page resident
+    if (c.heap > mem_available() * 8 / 10) {
+        printf("%-22s skipped: not enough free memory\n", label);
+        return;
+    }
+    heap_size = c.heap;
+    heap = mmap(NULL, heap_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (heap == MAP_FAILED) {
+        printf("%-22s skipped: %s\n", label, strerror(errno));
+        return;
+    }
+    memset(heap, 1, heap_size);
+    touch_pages = c.touch;
+
+    pthread_t idle[256];
+    int nidle = c.threads < 256 ? c.threads : 256;
+    for (int t = 0; t < nidle; t++) pthread_create(&idle[t], NULL, idle_thread, NULL);
+
+    for (int m = MECH_FORK; m <= MECH_SPAWN; m++) {
+        // Big heaps make fork/clone3 slow; keep each point bounded
+        int runs = (m == MECH_FORK || m == MECH_CLONE3) && c.heap >= (512ul << 20) ? n / 4 + 1 : n;
+        measure(label, m, runs);
+    }
+    fflush(stdout);
+
+    for (int t = 0; t < nidle; t++) {
+        pthread_cancel(idle[t]);
+        pthread_join(idle[t], NULL);
+    }
+    munmap(heap, heap_size);
+}
+
+int main(int argc, char *argv[]) {
+    int n = argc > 1 ? atoi(argv[1]) : 200;
+    page_size = sysconf(_SC_PAGESIZE);
+
+    slot = mmap(NULL, sizeof(*slot), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (slot == MAP_FAILED) {
+        perror("mmap");
+        return EXIT_FAILURE;
+    }
+
+    printf("%d creations per row; times in us, faults per creation\n", n);
+    printf("%-22s %-12s %9s %9s %9s %9s %9s %9s %9s\n", "config", "mechanism",
+           "create50", "create99", "createmax", "start50", "start99", "pfaults", "cfaults");
+
+    char label[64];
+    size_t heaps[] = { 1, 64, 512, 2048 };
+    for (size_t i = 0; i < sizeof(heaps) / sizeof(heaps[0]); i++) {
+        snprintf(label, sizeof(label), "heap=%zuM", heaps[i]);
+        sweep_point(label, (struct Config){ heaps[i] << 20, 0, 0 }, n);
+    }
+
+    size_t touches[] = { 16, 256, 4096 };
+    for (size_t i = 0; i < sizeof(touches) / sizeof(touches[0]); i++) {
+        snprintf(label, sizeof(label), "heap=64M touch=%zu", touches[i]);
+        sweep_point(label, (struct Config){ 64ul << 20, touches[i], 0 }, n);
+    }
+
+    int threads[] = { 4, 32 };
+    for (size_t i = 0; i < sizeof(threads) / sizeof(threads[0]); i++) {
+        snprintf(label, sizeof(label), "heap=64M threads=%d", threads[i]);
+        sweep_point(label, (struct Config){ 64ul << 20, 0, threads[i] }, n);
+    }
+
+    return 0;
+}
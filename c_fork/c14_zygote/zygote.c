@@ -0,0 +1,327 @@
+// Zygote: a small pre-initialized template process that forks on request.
+//
+// tarefa3/fork_pid.c and tarefa6/spawn.c fork every child straight from the
+// experiment driver, so each fork copies the driver's page tables and the
+// child starts with the driver's whole (copy-on-write) address space. The
+// zygote is forked once, before the driver grows, and stays small. The driver
+// sends it spawn requests over a UNIX socket; the zygote forks with
+// clone3(CLONE_PIDFD) and passes the child's pidfd back with SCM_RIGHTS. The
+// driver then watches, signals and waits for the child through that pidfd.
+//
+// The zygote is the children's parent and lets the kernel reap them (SIGCHLD
+// ignored); the driver's pidfd still becomes readable when the child exits.
+//
+// Usage: ./zygote [children] [driver MiB]
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <poll.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/pidfd.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <linux/sched.h>
+
+enum FORK_RESULT {
+    FORK_FAIL = -1,
+    FORK_CHILD = 0,
+    FORK_PARENT = 1,
+};
+
+enum FORK_RESULT check_fork(pid_t pid) {
+    if (pid < 0) return FORK_FAIL;
+    if (pid > 0) return FORK_PARENT;
+    return FORK_CHILD;
+}
+
+// What a zygote child runs; there is no exec, the code is already loaded
+enum ZygoteTask {
+    TASK_EXIT,            // exit(arg)
+    TASK_SLEEP,           // sleep arg ms, exit 0
+    TASK_SPIN,            // burn CPU for arg ms, exit 0
+    TASK_PAUSE,           // wait for a signal
+};
+
+struct ZygoteRequest {
+    uint32_t task;
+    uint32_t arg;
+};
+
+struct ZygoteReply {
+    int32_t pid;
+    int32_t error;        // errno from the zygote, 0 on success
+};
+
+struct Zygote {
+    pid_t pid;
+    int sock;
+};
+
+static double now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+void zygote_task(struct ZygoteRequest r) {
+    double end;
+
+    switch (r.task) {
+        case TASK_EXIT:
+            _exit(r.arg);
+        case TASK_SLEEP:
+            usleep(r.arg * 1000);
+            _exit(0);
+        case TASK_SPIN:
+            end = now_us() + r.arg * 1000.0;
+            while (now_us() < end);
+            _exit(0);
+        case TASK_PAUSE:
+            pause();
+            _exit(0);
+    }
+    _exit(127);
+}
+
+// clone3 without CLONE_VM behaves like fork() but also hands back a pidfd,
+// so there is no window where the child could exit and be reaped before
+// pidfd_open() gets to it
+static pid_t fork_pidfd(int *pidfd) {
+    struct clone_args args;
+    memset(&args, 0, sizeof(args));
+    args.flags = CLONE_PIDFD;
+    args.pidfd = (uint64_t)(uintptr_t)pidfd;
+    args.exit_signal = SIGCHLD;
+    return syscall(SYS_clone3, &args, sizeof(args));
+}
+
+static int send_reply(int sock, struct ZygoteReply reply, int fd) {
+    struct iovec iov = { &reply, sizeof(reply) };
+    union {
+        char buf[CMSG_SPACE(sizeof(int))];
+        struct cmsghdr align;
+    } control;
+    struct msghdr msg = { .msg_iov = &iov, .msg_iovlen = 1 };
+
+    if (fd >= 0) {
+        msg.msg_control = control.buf;
+        msg.msg_controllen = sizeof(control.buf);
+        struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+        cmsg->cmsg_level = SOL_SOCKET;
+        cmsg->cmsg_type = SCM_RIGHTS;
+        cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+        memcpy(CMSG_DATA(cmsg), &fd, sizeof(int));
+    }
+    return sendmsg(sock, &msg, 0) == -1 ? -1 : 0;
+}
+
+void zygote_loop(int sock) {
+    // Kernel reaps our children; the requester learns of exits via pidfd
+    signal(SIGCHLD, SIG_IGN);
+
+    struct ZygoteRequest r;
+    while (recv(sock, &r, sizeof(r), 0) == sizeof(r)) {
+        int pidfd = -1;
+        pid_t pid = fork_pidfd(&pidfd);
+
+        switch (check_fork(pid)) {
+            case FORK_FAIL:
+                send_reply(sock, (struct ZygoteReply){ -1, errno }, -1);
+                break;
+            case FORK_CHILD:
+                close(sock);
+                signal(SIGCHLD, SIG_DFL);
+                zygote_task(r);
+                break;
+            case FORK_PARENT:
+                send_reply(sock, (struct ZygoteReply){ pid, 0 }, pidfd);
+                close(pidfd);
+                break;
+        }
+    }
+    _exit(0);
+}
+
+int zygote_start(struct Zygote *z) {
+    int sv[2];
+    if (socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, sv) == -1) {
+        perror("socketpair");
+        return -1;
+    }
+
+    fflush(stdout);
+    pid_t pid = fork();
+
+    switch (check_fork(pid)) {
+        case FORK_FAIL:
+            perror("fork");
+            return -1;
+        case FORK_CHILD:
+            close(sv[0]);
+            zygote_loop(sv[1]);
+            break;
+        case FORK_PARENT:
+            close(sv[1]);
+            z->pid = pid;
+            z->sock = sv[0];
+            break;
+    }
+    return 0;
+}
+
+// Returns the child's pidfd (and its pid in *pid), or -1 with errno set
+int zygote_spawn(struct Zygote *z, enum ZygoteTask task, uint32_t arg, pid_t *pid) {
+    struct ZygoteRequest r = { task, arg };
+    if (send(z->sock, &r, sizeof(r), 0) == -1) return -1;
+
+    struct ZygoteReply reply;
+    struct iovec iov = { &reply, sizeof(reply) };
+    union {
+        char buf[CMSG_SPACE(sizeof(int))];
+        struct cmsghdr align;
+    } control;
+    struct msghdr msg = { .msg_iov = &iov, .msg_iovlen = 1,
+                          .msg_control = control.buf, .msg_controllen = sizeof(control.buf) };
+
+    if (recvmsg(z->sock, &msg, MSG_CMSG_CLOEXEC) != sizeof(reply)) return -1;
+    if (reply.error != 0) {
+        errno = reply.error;
+        return -1;
+    }
+
+    struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+    if (cmsg == NULL || cmsg->cmsg_type != SCM_RIGHTS) {
+        errno = EPROTO;
+        return -1;
+    }
+    int pidfd;
+    memcpy(&pidfd, CMSG_DATA(cmsg), sizeof(int));
+    *pid = reply.pid;
+    return pidfd;
+}
+
+void zygote_stop(struct Zygote *z) {
+    close(z->sock);
+    waitpid(z->pid, NULL, 0);
+}
+
+// Block until the process behind pidfd has exited
+void pidfd_wait_exit(int pidfd) {
+    struct pollfd p = { pidfd, POLLIN, 0 };
+    while (poll(&p, 1, -1) == -1 && errno == EINTR);
+}
+
+// ---- benchmark ----
+
+long rss_kib(pid_t pid) {
+    char path[64], line[128];
+    long kib = -1;
+    snprintf(path, sizeof(path), "/proc/%d/status", pid);
+    FILE *f = fopen(path, "r");
+    while (f && fgets(line, sizeof(line), f)) {
+        if (sscanf(line, "VmRSS: %ld kB", &kib) == 1) break;
+    }
+    if (f) fclose(f);
+    return kib;
+}
+
+static int compare_double(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+void summary(const char *name, double *lat, int n, double wall, long child_rss) {
+    qsort(lat, n, sizeof(double), compare_double);
+    printf("%-8s %10.0f %9.1f %9.1f %9.1f %12ld\n", name, n / wall * 1e6,
+           lat[n / 2], lat[n * 99 / 100], lat[n - 1], child_rss);
+}
+
+int main(int argc, char *argv[]) {
+    int n = argc > 1 ? atoi(argv[1]) : 5000;
+    size_t mib = argc > 2 ? strtoull(argv[2], NULL, 10) : 1024;
+
+    // The zygote is forked while the driver is still small
+    struct Zygote z;
+    if (zygote_start(&z) == -1) return EXIT_FAILURE;
+
+    // Then the driver grows to experiment size
+    char *ballast = mmap(NULL, mib << 20, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (ballast == MAP_FAILED) {
+        perror("mmap");
+        return EXIT_FAILURE;
+    }
+    memset(ballast, 1, mib << 20);
+
+    double *lat = malloc(n * sizeof(double));
+    printf("driver RSS %ld KiB, zygote RSS %ld KiB, %d children each\n",
+           rss_kib(getpid()), rss_kib(z.pid), n);
+    printf("%-8s %10s %9s %9s %9s %12s\n", "path", "spawns/s", "p50(us)", "p99(us)", "max(us)", "child KiB");
+
+    // Direct: fork from the big driver, reap with waitpid
+    double start = now_us();
+    for (int i = 0; i < n; i++) {
+        double t = now_us();
+        pid_t pid = fork();
+        switch (check_fork(pid)) {
+            case FORK_FAIL:
+                perror("fork");
+                return EXIT_FAILURE;
+            case FORK_CHILD:
+                _exit(0);
+            case FORK_PARENT:
+                lat[i] = now_us() - t;
+                waitpid(pid, NULL, 0);
+                break;
+        }
+    }
+    double wall = now_us() - start;
+
+    long direct_rss = -1;
+    pid_t probe = fork();
+    if (probe == 0) {
+        pause();
+        _exit(0);
+    }
+    usleep(10000);
+    direct_rss = rss_kib(probe);
+    kill(probe, SIGKILL);
+    waitpid(probe, NULL, 0);
+    summary("direct", lat, n, wall, direct_rss);
+
+    // Zygote: request, receive pidfd, wait on it
+    start = now_us();
+    for (int i = 0; i < n; i++) {
+        pid_t pid;
+        double t = now_us();
+        int pidfd = zygote_spawn(&z, TASK_EXIT, 0, &pid);
+        if (pidfd == -1) {
+            perror("zygote_spawn");
+            return EXIT_FAILURE;
+        }
+        lat[i] = now_us() - t;
+        pidfd_wait_exit(pidfd);
+        close(pidfd);
+    }
+    wall = now_us() - start;
+
+    pid_t pid;
+    int pidfd = zygote_spawn(&z, TASK_PAUSE, 0, &pid);
+    usleep(10000);
+    long zygote_rss = rss_kib(pid);
+    pidfd_send_signal(pidfd, SIGKILL, NULL, 0);
+    pidfd_wait_exit(pidfd);
+    close(pidfd);
+    summary("zygote", lat, n, wall, zygote_rss);
+
+    zygote_stop(&z);
+    free(lat);
+    return 0;
+}
@@ -1,9 +1,15 @@
 #include <sys/wait.h>
+#include <sys/resource.h>
+#include <sys/prctl.h>
+#include <sys/mman.h>
 #include <unistd.h>
 #include <stdio.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
+#include <errno.h>
+#include <time.h>
 
 struct Experiment {
     size_t repetitions;
@@ -28,6 +34,71 @@ enum FORK_RESULT check_fork(pid_t pid){
     return FORK_CHILD;
 }
 
+// One reaped process: who, how it ended, what it cost and when we reaped it.
+// The reap can trail the exit: in stress mode by up to a whole batch of forks.
+struct ExitRecord {
+    pid_t pid;
+    int status;
+    uint64_t t_reaped;          // CLOCK_MONOTONIC ns at reap time, not exit time
+    struct rusage ru;
+};
+
+// Preallocated exit table. As child subreaper (stress mode, or -r for the
+// classic experiment), orphaned grandchildren are reparented to us instead
+// of init, so they land here too.
+struct Reaper {
+    struct ExitRecord *records;
+    size_t capacity;
+    size_t count;
+    size_t dropped;             // reaped after the table filled up
+};
+
+uint64_t now_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+int reaper_init(struct Reaper *r, size_t capacity, bool subreaper) {
+    if (subreaper && prctl(PR_SET_CHILD_SUBREAPER, 1, 0, 0, 0) == -1) {
+        perror("prctl(PR_SET_CHILD_SUBREAPER)");
+        return -1;
+    }
+    // Populated up front so recording an exit never page-faults
+    r->records = mmap(NULL, capacity * sizeof(struct ExitRecord), PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE, -1, 0);
+    if (r->records == MAP_FAILED) {
+        perror("mmap");
+        return -1;
+    }
+    r->capacity = capacity;
+    r->count = 0;
+    r->dropped = 0;
+    return 0;
+}
+
+// Reap until at least `want` exits were collected (0: only what is already
+// dead), then drain every other zombie without blocking. Returns the batch
+// size. wait4(-1) is waitid(P_ALL) plus the rusage glibc's waitid drops.
+size_t reaper_collect(struct Reaper *r, size_t want) {
+    size_t got = 0;
+    for (;;) {
+        struct ExitRecord rec;
+        rec.pid = wait4(-1, &rec.status, got < want ? 0 : WNOHANG, &rec.ru);
+        if (rec.pid == -1 && errno == EINTR) continue;
+        if (rec.pid <= 0) break;    // nothing dead yet, or ECHILD
+        rec.t_reaped = now_ns();
+        if (r->count < r->capacity) r->records[r->count++] = rec;
+        else r->dropped++;
+        got++;
+    }
+    return got;
+}
+
+void reaper_free(struct Reaper *r) {
+    munmap(r->records, r->capacity * sizeof(struct ExitRecord));
+}
+
 void print_process(struct Experiment *e, char const fc[], char id) {
     printf("%s%zu\t%s\t%d\t%d\t%c\n", e->acronym, e->repetition_current, fc,getpid(),getppid(), id);
     setbuf(stdout, NULL);
@@ -55,7 +126,9 @@ void experiment(struct Experiment *e) {
             e->grand_child = grand_child_pid;
             switch (check_fork(grand_child_pid)) {
                 case FORK_FAIL:
-                break;
+                    // Tell the driver there is no grandchild to wait for
+                    perror("fork");
+                    exit(EXIT_FAILURE);
                 case FORK_CHILD:
                     strcpy(fc, "G");
                     print_process(e, fc,'A');
@@ -82,7 +155,147 @@ void experiment(struct Experiment *e) {
     }
 }
 
-int main() {
+// Mean of a nanosecond sum in milliseconds
+double mean_ms(uint64_t sum, size_t n) {
+    return n ? sum / 1e6 / n : 0.0;
+}
+
+double cpu_ms(struct rusage *ru) {
+    return (ru->ru_utime.tv_sec + ru->ru_stime.tv_sec) * 1e3
+         + (ru->ru_utime.tv_usec + ru->ru_stime.tv_usec) / 1e3;
+}
+
+struct Tally {
+    size_t count;
+    double cpu_ms;
+};
+
+void tally(struct ExitRecord *rec, uint8_t *direct, struct Tally *children, struct Tally *orphans) {
+    struct Tally *t = direct[rec->pid] ? children : orphans;
+    direct[rec->pid] = 0;
+    t->count++;
+    t->cpu_ms += cpu_ms(&rec->ru);
+}
+
+// N forks, each child forking an orphan grandchild and exiting at once. No
+// per-fork wait: zombies are drained in batches every `batch` forks, so the
+// backlog stays bounded no matter how large N gets.
+int stress(size_t n, size_t batch) {
+    struct Reaper reaper;
+    if (reaper_init(&reaper, 2 * n + 16, true) == -1) return EXIT_FAILURE;
+
+    // pid -> "is a direct child" map, to tell orphans apart after the fact
+    size_t pid_max = 4194304;
+    FILE *f = fopen("/proc/sys/kernel/pid_max", "r");
+    if (f) {
+        if (fscanf(f, "%zu", &pid_max) != 1) pid_max = 4194304;
+        fclose(f);
+    }
+    uint8_t *direct = calloc(pid_max + 1, 1);
+    if (direct == NULL) {
+        perror("calloc");
+        reaper_free(&reaper);
+        return EXIT_FAILURE;
+    }
+
+    size_t backlog = 0, max_backlog = 0, batches = 0;
+    size_t seen = 0;
+    struct Tally children = {0, 0}, orphans = {0, 0};
+    uint64_t start = now_ns();
+
+    for (size_t i = 0; i < n; i++) {
+        pid_t child = fork();
+        switch (check_fork(child)) {
+            case FORK_FAIL:
+                // Out of pids/memory: reap what we have and retry
+                if (backlog == 0) {
+                    perror("fork");
+                    return EXIT_FAILURE;
+                }
+                backlog -= reaper_collect(&reaper, 1);
+                i--;
+                continue;
+            case FORK_CHILD:
+                if (fork() == 0) _exit(0);  // grandchild, orphaned right away
+                _exit(0);
+            case FORK_PARENT:
+                direct[child] = 1;
+                backlog += 2;
+                break;
+        }
+        if (backlog > max_backlog) max_backlog = backlog;
+        if ((i + 1) % batch == 0) {
+            backlog -= reaper_collect(&reaper, 0);
+            batches++;
+        }
+        // Classify as we go: a reaped child's pid may come back as a grandchild
+        for (; seen < reaper.count; seen++) tally(&reaper.records[seen], direct, &children, &orphans);
+    }
+    while (backlog > 0) {
+        size_t got = reaper_collect(&reaper, backlog);
+        if (got == 0) break;
+        backlog -= got;
+        batches++;
+    }
+    uint64_t wall = now_ns() - start;
+    for (; seen < reaper.count; seen++) tally(&reaper.records[seen], direct, &children, &orphans);
+
+    printf("forks\t%zu\n", n);
+    printf("wall_s\t%.3f\n", wall / 1e9);
+    printf("forks_per_s\t%.0f\n", n / (wall / 1e9));
+    printf("reaped_children\t%zu\n", children.count);
+    printf("reaped_orphans\t%zu\n", orphans.count);
+    printf("dropped\t%zu\n", reaper.dropped);
+    printf("batches\t%zu\n", batches);
+    printf("max_zombie_backlog\t%zu\n", max_backlog);
+    printf("child_cpu_us_mean\t%.1f\n", children.count ? children.cpu_ms * 1e3 / children.count : 0.0);
+    printf("orphan_cpu_us_mean\t%.1f\n", orphans.count ? orphans.cpu_ms * 1e3 / orphans.count : 0.0);
+
+    free(direct);
+    reaper_free(&reaper);
+    return 0;
+}
+
+// Reap what one repetition left: its child, if the fork worked, and as
+// subreaper the grandchild too, unless the child exited 1 because it could
+// not fork one. Either may go first. Returns where its records start.
+size_t collect_repetition(struct Reaper *r, struct Experiment *e, bool subreaper) {
+    size_t first = r->count;
+    if (e->child <= 0) {
+        reaper_collect(r, 0);
+        return first;
+    }
+
+    size_t want = 1, got = 0;
+    bool child_done = false;
+    while (!child_done || got < want) {
+        size_t before = r->count;
+        size_t need = (child_done ? want : (want > got + 1 ? want : got + 1)) - got;
+        size_t n = reaper_collect(r, need);
+        if (n == 0) break;          // ECHILD: nothing left to wait for
+        got += n;
+        for (size_t k = before; k < r->count; k++) {
+            struct ExitRecord *rec = &r->records[k];
+            if (rec->pid != e->child) continue;
+            child_done = true;
+            if (subreaper && WIFEXITED(rec->status) && WEXITSTATUS(rec->status) == 0) want = 2;
+        }
+        // Only the table knows the child's pid; past capacity, stop guessing
+        if (r->dropped) break;
+    }
+    return first;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc > 1 && strcmp(argv[1], "stress") == 0) {
+        return stress(argc > 2 ? strtoull(argv[2], NULL, 10) : 100000,
+                      argc > 3 ? strtoull(argv[3], NULL, 10) : 256);
+    }
+
+    // -r: become subreaper, so orphaned grandchildren report our pid from
+    // getppid() instead of init's, and their exits are timed here too
+    bool subreaper = argc > 1 && strcmp(argv[1], "-r") == 0;
+
     struct Experiment overseer = {3,0,"M\0", "Main\0", 0, 0};
 
     struct Experiment experiments[] = {
@@ -93,6 +306,20 @@ int main() {
 
     size_t nof_experiments = sizeof(experiments)/sizeof(struct Experiment);
 
+    size_t total = 0;
+    for (size_t e = 0; e < nof_experiments; e++) total += experiments[e].repetitions;
+    total *= overseer.repetitions;
+
+    struct Reaper reaper;
+    if (reaper_init(&reaper, 2 * total, subreaper) == -1) return EXIT_FAILURE;
+
+    // Per experiment: when child and grandchild were reaped, after the first
+    // fork. collect_repetition waits for them, so this is close to their exit.
+#define NEXP (sizeof(experiments) / sizeof(experiments[0]))
+    uint64_t child_reaped[NEXP] = {0}, grand_reaped[NEXP] = {0};
+    double grand_cpu[NEXP] = {0};
+    size_t grand_count[NEXP] = {0};
+
     printf("%s%zu\t%s\t%d\t%d\t%c\n", overseer.acronym, overseer.repetition_current, "I",getpid(),getppid(), 'I');
     setbuf(stdout, NULL);
 
@@ -100,10 +327,34 @@ int main() {
         for (size_t e = 0; e < nof_experiments; e++){
             for (size_t r = 0; r < experiments[e].repetitions; r++ ){
                 experiments[e].repetition_current = r;
+                uint64_t t0 = now_ns();
                 experiment(&experiments[e]);
-                wait(&experiments[e].child);
-                wait(&experiments[e].grand_child);
+
+                // The child, and with -r the reparented grandchild
+                size_t first = collect_repetition(&reaper, &experiments[e], subreaper);
+                for (size_t k = first; k < reaper.count; k++) {
+                    struct ExitRecord *rec = &reaper.records[k];
+                    if (rec->pid == experiments[e].child) {
+                        child_reaped[e] += rec->t_reaped - t0;
+                    } else {
+                        grand_reaped[e] += rec->t_reaped - t0;
+                        grand_cpu[e] += cpu_ms(&rec->ru);
+                        grand_count[e]++;
+                    }
+                }
             }
         }
     }
+
+    // On stderr, so the stdout log keeps the format analysis/ parses.
+    // Without -r the grandchildren go to init and their columns stay 0.
+    fprintf(stderr, "exp\treaped\tchild_reaped_ms\tgrandchild_reaped_ms\tgrandchild_cpu_ms\n");
+    for (size_t e = 0; e < nof_experiments; e++) {
+        size_t runs = experiments[e].repetitions * overseer.repetitions;
+        fprintf(stderr, "%s\t%zu\t%.3f\t%.3f\t%.3f\n", experiments[e].acronym, runs + grand_count[e],
+                mean_ms(child_reaped[e], runs), mean_ms(grand_reaped[e], grand_count[e]),
+                grand_count[e] ? grand_cpu[e] / grand_count[e] : 0.0);
+    }
+    reaper_free(&reaper);
+    return 0;
 }
@@ -0,0 +1,554 @@
+// One-pass aggregator for the tarefa6 observation logs.
+//
+// Computes the tables analysis.py builds (per-part %CPU statistics, nice and
+// process-state distributions, mean %CPU per priority) without holding the
+// samples in memory: every statistic is a running sum or a fixed-size
+// histogram (%CPU has ps' 0.1 resolution, so the median from a 0.1-wide
+// histogram is exact). Inputs are the ps-style text logs (*.log, first
+// character of the name is the part) or binary sample logs (*.bin);
+// files and chunks of binary logs are spread across one thread per CPU.
+//
+// Writes summary_data.csv, cpu_stats_table.tex, process_states_table.tex,
+// priority_cpu.csv, and cpu_hist.csv and process_states.csv (what
+// analysis.py --figures plots) into the output directory.
+//
+// Usage: ./aggregate [-o DIR] [log dir or files...]     (defaults: ./latex ./log)
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <string.h>
+#include <math.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "samplelog.h"
+
+#define CPU_BINS 10001          // %CPU 0.0 .. 1000.0 in steps of 0.1
+#define MAX_STATES 32
+#define MIN_PRI (-100)          // ps PRI: 39 - kernel priority, RT goes negative
+#define MAX_PRI 139
+#define CHUNK_RECORDS (1u << 20)
+
+struct StateCount {
+    char stat[8];
+    uint64_t n;
+};
+
+struct PartStats {
+    uint64_t count;
+    double sum, sumsq, min, max;
+    uint32_t hist[CPU_BINS];
+    uint64_t nice[40];          // nice -20..19
+    struct StateCount states[MAX_STATES];
+    int nstates;
+    double pri_sum[MAX_PRI - MIN_PRI + 1];
+    uint64_t pri_n[MAX_PRI - MIN_PRI + 1];
+};
+
+// Indexed by the part character
+struct Aggregate {
+    struct PartStats *parts[128];
+};
+
+struct Job {
+    const char *path;
+    int binary;
+    uint64_t first, last;       // record range, binary logs only
+};
+
+struct Work {
+    struct Job *jobs;
+    size_t njobs;
+    _Atomic size_t next;
+};
+
+struct PartStats *part_stats(struct Aggregate *a, char part) {
+    unsigned char k = (unsigned char)part & 127;
+    if (a->parts[k] == NULL) {
+        a->parts[k] = calloc(1, sizeof(struct PartStats));
+        a->parts[k]->min = INFINITY;
+        a->parts[k]->max = -INFINITY;
+    }
+    return a->parts[k];
+}
+
+void add_state(struct PartStats *s, const char *stat, uint64_t n) {
+    for (int i = 0; i < s->nstates; i++) {
+        if (strcmp(s->states[i].stat, stat) == 0) {
+            s->states[i].n += n;
+            return;
+        }
+    }
+    if (s->nstates == MAX_STATES) return;
+    snprintf(s->states[s->nstates].stat, sizeof(s->states[0].stat), "%s", stat);
+    s->states[s->nstates++].n = n;
+}
+
+// Fold one process observation into its part
+void add_sample(struct Aggregate *a, char part, double cpu, int nice, int pri, const char *stat) {
+    struct PartStats *s = part_stats(a, part);
+    s->count++;
+    s->sum += cpu;
+    s->sumsq += cpu * cpu;
+    if (cpu < s->min) s->min = cpu;
+    if (cpu > s->max) s->max = cpu;
+
+    long bin = lround(cpu * 10);
+    if (bin < 0) bin = 0;
+    if (bin >= CPU_BINS) bin = CPU_BINS - 1;
+    s->hist[bin]++;
+
+    if (nice >= -20 && nice <= 19) s->nice[nice + 20]++;
+    if (pri >= MIN_PRI && pri <= MAX_PRI) {
+        s->pri_sum[pri - MIN_PRI] += cpu;
+        s->pri_n[pri - MIN_PRI]++;
+    }
+    add_state(s, stat, 1);
+}
+
+void merge(struct Aggregate *into, struct Aggregate *from) {
+    for (int k = 0; k < 128; k++) {
+        struct PartStats *f = from->parts[k];
+        if (f == NULL) continue;
+        struct PartStats *s = part_stats(into, k);
+        s->count += f->count;
+        s->sum += f->sum;
+        s->sumsq += f->sumsq;
+        if (f->min < s->min) s->min = f->min;
+        if (f->max > s->max) s->max = f->max;
+        for (int b = 0; b < CPU_BINS; b++) s->hist[b] += f->hist[b];
+        for (int n = 0; n < 40; n++) s->nice[n] += f->nice[n];
+        for (int i = 0; i < f->nstates; i++) add_state(s, f->states[i].stat, f->states[i].n);
+        for (int p = 0; p <= MAX_PRI - MIN_PRI; p++) {
+            s->pri_sum[p] += f->pri_sum[p];
+            s->pri_n[p] += f->pri_n[p];
+        }
+        free(f);
+        from->parts[k] = NULL;
+    }
+}
+
+// Same selection as analysis.py's filter_experiment_processes
+int is_experiment(const char *comm) {
+    return strstr(comm, "t9_") != NULL || strstr(comm, "spawn") != NULL;
+}
+
+// ps-style log: PID PRI NI STAT %CPU COMMAND rest...; header lines contain
+// "PID", anything with fewer than seven fields is skipped like analysis.py does
+void scan_text(struct Aggregate *a, const char *path) {
+    const char *base = strrchr(path, '/');
+    char part = base ? base[1] : path[0];
+
+    FILE *f = fopen(path, "r");
+    if (f == NULL) {
+        perror(path);
+        return;
+    }
+    char *line = NULL;
+    size_t cap = 0;
+    while (getline(&line, &cap, f) != -1) {
+        if (strstr(line, "PID") != NULL) continue;
+
+        char *field[7];
+        int n = 0;
+        char *save = NULL;
+        for (char *t = strtok_r(line, " \t\n", &save); t && n < 7; t = strtok_r(NULL, " \t\n", &save)) {
+            field[n++] = t;
+        }
+        if (n < 7 || !is_experiment(field[5])) continue;
+
+        char *end;
+        double cpu = strtod(field[4], &end);
+        if (end == field[4]) continue;
+        add_sample(a, part, cpu, atoi(field[2]), atoi(field[1]), field[3]);
+    }
+    free(line);
+    fclose(f);
+}
+
+// Maps a binary sample log; returns its records and header, or NULL
+const struct SampleRecord *map_samples(const char *path, const struct SampleLogHeader **header,
+                                       uint64_t *count, size_t *bytes) {
+    int fd = open(path, O_RDONLY);
+    struct stat st;
+    if (fd == -1 || fstat(fd, &st) == -1 || (size_t)st.st_size < SAMPLELOG_DATA_OFFSET) {
+        if (fd != -1) close(fd);
+        return NULL;
+    }
+    void *map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) return NULL;
+
+    const struct SampleLogHeader *h = map;
+    if (memcmp(h->magic, SAMPLELOG_MAGIC, sizeof(h->magic)) != 0 || h->version != SAMPLELOG_VERSION
+        || h->record_size != sizeof(struct SampleRecord)) {
+        fprintf(stderr, "%s: not a version %d sample log\n", path, SAMPLELOG_VERSION);
+        munmap(map, st.st_size);
+        return NULL;
+    }
+    uint64_t n = atomic_load(&((struct SampleLogHeader *)map)->count);
+    if (n > h->capacity) n = h->capacity;
+    uint64_t fit = (st.st_size - SAMPLELOG_DATA_OFFSET) / sizeof(struct SampleRecord);
+    *count = n < fit ? n : fit;
+    *header = h;
+    *bytes = st.st_size;
+    return (const struct SampleRecord *)((const char *)map + SAMPLELOG_DATA_OFFSET);
+}
+
+void scan_binary(struct Aggregate *a, struct Job *job) {
+    const struct SampleLogHeader *h;
+    uint64_t count;
+    size_t bytes;
+    const struct SampleRecord *rec = map_samples(job->path, &h, &count, &bytes);
+    if (rec == NULL) return;
+
+    for (uint64_t i = job->first; i < job->last && i < count; i++) {
+        const struct SampleRecord *r = &rec[i];
+        char comm[sizeof(r->comm) + 1];
+        memcpy(comm, r->comm, sizeof(r->comm));
+        comm[sizeof(r->comm)] = '\0';
+        if (!is_experiment(comm)) continue;
+
+        // ps' %CPU and STAT, rebuilt from the raw fields
+        double lifetime = (h->base_boottime_ns + r->t_ns) / 1e9 - (double)r->starttime / h->clk_tck;
+        double cpu = lifetime > 0 ? (double)(r->utime + r->stime) / h->clk_tck / lifetime * 100 : 0;
+        cpu = round(cpu * 10) / 10;
+
+        char stat[8];
+        int k = 0;
+        stat[k++] = r->state;
+        if (r->nice < 0) stat[k++] = '<';
+        if (r->nice > 0) stat[k++] = 'N';
+        if (r->threads > 1) stat[k++] = 'l';
+        stat[k] = '\0';
+
+        add_sample(a, r->part, cpu, r->nice, 39 - r->priority, stat);
+    }
+    munmap((void *)h, bytes);
+}
+
+void *worker(void *arg) {
+    struct Work *w = arg;
+    struct Aggregate *a = calloc(1, sizeof(struct Aggregate));
+    for (;;) {
+        size_t j = atomic_fetch_add(&w->next, 1);
+        if (j >= w->njobs) break;
+        if (w->jobs[j].binary) scan_binary(a, &w->jobs[j]);
+        else scan_text(a, w->jobs[j].path);
+    }
+    return a;
+}
+
+// ---- job list ----
+
+struct JobList {
+    struct Job *jobs;
+    size_t n, cap;
+};
+
+void push_job(struct JobList *l, struct Job job) {
+    if (l->n == l->cap) {
+        l->cap = l->cap ? l->cap * 2 : 64;
+        l->jobs = realloc(l->jobs, l->cap * sizeof(struct Job));
+    }
+    l->jobs[l->n++] = job;
+}
+
+int ends_with(const char *s, const char *suffix) {
+    size_t n = strlen(s), m = strlen(suffix);
+    return n >= m && strcmp(s + n - m, suffix) == 0;
+}
+
+void add_path(struct JobList *l, const char *path) {
+    struct stat st;
+    if (stat(path, &st) == -1) {
+        perror(path);
+        return;
+    }
+    if (S_ISDIR(st.st_mode)) {
+        // A run started with -t leaves both forms of the same samples: take
+        // the binary log when there is one so nothing is counted twice
+        struct dirent **names;
+        int n = scandir(path, &names, NULL, alphasort);
+        if (n < 0) {
+            perror(path);
+            return;
+        }
+        const char *want = ".log";
+        for (int i = 0; i < n; i++) {
+            if (ends_with(names[i]->d_name, ".bin")) want = ".bin";
+        }
+        for (int i = 0; i < n; i++) {
+            if (ends_with(names[i]->d_name, want)) {
+                char *child;
+                if (asprintf(&child, "%s/%s", path, names[i]->d_name) != -1) add_path(l, child);
+            }
+            free(names[i]);
+        }
+        free(names);
+        return;
+    }
+
+    if (!ends_with(path, ".bin")) {
+        push_job(l, (struct Job){ path, 0, 0, 0 });
+        return;
+    }
+    // Big binary logs are cut into chunks so several threads share one file
+    const struct SampleLogHeader *h;
+    uint64_t count;
+    size_t bytes;
+    if (map_samples(path, &h, &count, &bytes) == NULL) return;
+    munmap((void *)h, bytes);
+    for (uint64_t first = 0; first < count; first += CHUNK_RECORDS) {
+        push_job(l, (struct Job){ path, 1, first, first + CHUNK_RECORDS });
+    }
+}
+
+// ---- output ----
+
+// Shortest representation that reads back as the same double, written the
+// way Python's repr writes it: positional unless the exponent is below -4 or
+// at least 16, and with ".0" on integral values
+void fmt_double(char *buf, size_t size, double v) {
+    if (!isfinite(v)) {
+        snprintf(buf, size, "%g", v);
+        return;
+    }
+    int prec = 0;
+    for (; prec < 17; prec++) {
+        snprintf(buf, size, "%.*e", prec, v);
+        if (strtod(buf, NULL) == v) break;
+    }
+    snprintf(buf, size, "%.*e", prec, v);
+    int exp = atoi(strchr(buf, 'e') + 1);
+    if (exp < -4 || exp >= 16) return;
+    snprintf(buf, size, "%.*f", prec > exp ? prec - exp : 0, v);
+    if (strchr(buf, '.') == NULL) strncat(buf, ".0", size - strlen(buf) - 1);
+}
+
+// %CPU value of the k-th smallest sample (0-based)
+double hist_kth(struct PartStats *s, uint64_t k) {
+    uint64_t seen = 0;
+    for (int b = 0; b < CPU_BINS; b++) {
+        seen += s->hist[b];
+        if (seen > k) return b / 10.0;
+    }
+    return NAN;
+}
+
+double median(struct PartStats *s) {
+    if (s->count % 2) return hist_kth(s, s->count / 2);
+    return (hist_kth(s, s->count / 2 - 1) + hist_kth(s, s->count / 2)) / 2;
+}
+
+double stddev(struct PartStats *s) {
+    double mean = s->sum / s->count;
+    double var = s->sumsq / s->count - mean * mean;
+    return var > 0 ? sqrt(var) : 0;
+}
+
+int compare_states(const void *a, const void *b) {
+    return strcmp(((const struct StateCount *)a)->stat, ((const struct StateCount *)b)->stat);
+}
+
+// A CSV field, quoted the way pandas does when it holds a comma
+void csv_field(FILE *f, const char *s) {
+    if (strchr(s, ',') == NULL && strchr(s, '"') == NULL) {
+        fputs(s, f);
+        return;
+    }
+    fputc('"', f);
+    for (; *s; s++) {
+        if (*s == '"') fputc('"', f);
+        fputc(*s, f);
+    }
+    fputc('"', f);
+}
+
+FILE *open_out(const char *dir, const char *name) {
+    char path[4096];
+    snprintf(path, sizeof(path), "%s/%s", dir, name);
+    FILE *f = fopen(path, "w");
+    if (f == NULL) perror(path);
+    return f;
+}
+
+void write_outputs(struct Aggregate *a, const char *dir) {
+    mkdir(dir, 0755);
+    char num[3][40];
+    char buf[1024];
+
+    for (int k = 0; k < 128; k++) {
+        if (a->parts[k]) qsort(a->parts[k]->states, a->parts[k]->nstates, sizeof(struct StateCount), compare_states);
+    }
+
+    FILE *f = open_out(dir, "summary_data.csv");
+    if (f) {
+        fprintf(f, ",Mean CPU %%,Median CPU %%,CPU Std Dev,Process Count,Nice Values,Process States\n");
+        for (int k = 0; k < 128; k++) {
+            struct PartStats *s = a->parts[k];
+            if (s == NULL || s->count == 0) continue;
+            fmt_double(num[0], sizeof(num[0]), s->sum / s->count);
+            fmt_double(num[1], sizeof(num[1]), median(s));
+            fmt_double(num[2], sizeof(num[2]), stddev(s));
+            fprintf(f, "Part %c,%s,%s,%s,%llu,", k, num[0], num[1], num[2], (unsigned long long)s->count);
+
+            int len = snprintf(buf, sizeof(buf), "{");
+            for (int n = 0; n < 40; n++) {
+                if (s->nice[n] == 0) continue;
+                len += snprintf(buf + len, sizeof(buf) - len, "%s%d: %llu", len > 1 ? ", " : "", n - 20,
+                                (unsigned long long)s->nice[n]);
+            }
+            snprintf(buf + len, sizeof(buf) - len, "}");
+            csv_field(f, buf);
+            fputc(',', f);
+
+            len = snprintf(buf, sizeof(buf), "{");
+            for (int i = 0; i < s->nstates; i++) {
+                len += snprintf(buf + len, sizeof(buf) - len, "%s'%s': %llu", i ? ", " : "", s->states[i].stat,
+                                (unsigned long long)s->states[i].n);
+            }
+            snprintf(buf + len, sizeof(buf) - len, "}");
+            csv_field(f, buf);
+            fputc('\n', f);
+        }
+        fclose(f);
+    }
+
+    f = open_out(dir, "cpu_stats_table.tex");
+    if (f) {
+        fprintf(f, "\\begin{tabular}{llllllr}\n\\toprule\n & mean & median & max & min & std & count \\\\\n\\midrule\n");
+        for (int k = 0; k < 128; k++) {
+            struct PartStats *s = a->parts[k];
+            if (s == NULL || s->count == 0) continue;
+            fprintf(f, "Part %c & %.2f & %.2f & %.2f & %.2f & %.2f & %llu \\\\\n", k, s->sum / s->count,
+                    median(s), s->max, s->min, stddev(s), (unsigned long long)s->count);
+        }
+        fprintf(f, "\\bottomrule\n\\end{tabular}\n");
+        fclose(f);
+    }
+
+    // Rows are every state seen in any part, columns the parts
+    struct PartStats all = { 0 };
+    int nparts = 0;
+    for (int k = 0; k < 128; k++) {
+        if (a->parts[k] == NULL) continue;
+        nparts++;
+        for (int i = 0; i < a->parts[k]->nstates; i++) add_state(&all, a->parts[k]->states[i].stat, 0);
+    }
+    qsort(all.states, all.nstates, sizeof(struct StateCount), compare_states);
+
+    f = open_out(dir, "process_states_table.tex");
+    if (f) {
+        fprintf(f, "\\begin{tabular}{l");
+        for (int p = 0; p < nparts; p++) fputc('r', f);
+        fprintf(f, "}\n\\toprule\n");
+        for (int k = 0; k < 128; k++) if (a->parts[k]) fprintf(f, " & Part %c", k);
+        fprintf(f, " \\\\\n\\midrule\n");
+        for (int i = 0; i < all.nstates; i++) {
+            fprintf(f, "%s", all.states[i].stat);
+            for (int k = 0; k < 128; k++) {
+                struct PartStats *s = a->parts[k];
+                if (s == NULL) continue;
+                uint64_t n = 0;
+                for (int j = 0; j < s->nstates; j++) {
+                    if (strcmp(s->states[j].stat, all.states[i].stat) == 0) n = s->states[j].n;
+                }
+                fprintf(f, " & %llu", (unsigned long long)n);
+            }
+            fprintf(f, " \\\\\n");
+        }
+        fprintf(f, "\\bottomrule\n\\end{tabular}\n");
+        fclose(f);
+    }
+
+    // Per-priority mean %CPU (analysis.py's process_by_priority) and that
+    // priority's share of all CPU the part's processes received
+    f = open_out(dir, "priority_cpu.csv");
+    if (f) {
+        fprintf(f, "part,pri,samples,mean_cpu,cpu_share\n");
+        for (int k = 0; k < 128; k++) {
+            struct PartStats *s = a->parts[k];
+            if (s == NULL) continue;
+            for (int p = 0; p <= MAX_PRI - MIN_PRI; p++) {
+                if (s->pri_n[p] == 0) continue;
+                fprintf(f, "%c,%d,%llu,%.3f,%.4f\n", k, p + MIN_PRI, (unsigned long long)s->pri_n[p],
+                        s->pri_sum[p] / s->pri_n[p], s->sum > 0 ? s->pri_sum[p] / s->sum : 0);
+            }
+        }
+        fclose(f);
+    }
+
+    // The %CPU histogram at ps' resolution, empty bins left out
+    f = open_out(dir, "cpu_hist.csv");
+    if (f) {
+        fprintf(f, "part,cpu,samples\n");
+        for (int k = 0; k < 128; k++) {
+            struct PartStats *s = a->parts[k];
+            if (s == NULL) continue;
+            for (int b = 0; b < CPU_BINS; b++) {
+                if (s->hist[b]) fprintf(f, "%c,%.1f,%u\n", k, b / 10.0, s->hist[b]);
+            }
+        }
+        fclose(f);
+    }
+
+    f = open_out(dir, "process_states.csv");
+    if (f) {
+        fprintf(f, "part,stat,samples\n");
+        for (int k = 0; k < 128; k++) {
+            struct PartStats *s = a->parts[k];
+            if (s == NULL) continue;
+            for (int i = 0; i < s->nstates; i++) {
+                fprintf(f, "%c,", k);
+                csv_field(f, s->states[i].stat);
+                fprintf(f, ",%llu\n", (unsigned long long)s->states[i].n);
+            }
+        }
+        fclose(f);
+    }
+}
+
+int main(int argc, char *argv[]) {
+    const char *out = "./latex";
+    struct JobList jobs = { 0 };
+
+    int a = 1;
+    if (argc > 2 && strcmp(argv[1], "-o") == 0) {
+        out = argv[2];
+        a = 3;
+    }
+    if (a == argc) add_path(&jobs, "./log");
+    for (; a < argc; a++) add_path(&jobs, argv[a]);
+    if (jobs.n == 0) {
+        fprintf(stderr, "no .log or .bin inputs\n");
+        return EXIT_FAILURE;
+    }
+
+    cpu_set_t set;
+    int nthreads = sched_getaffinity(0, sizeof(set), &set) == 0 ? CPU_COUNT(&set) : 1;
+    if ((size_t)nthreads > jobs.n) nthreads = jobs.n;
+
+    struct Work work = { jobs.jobs, jobs.n, 0 };
+    pthread_t *threads = malloc(nthreads * sizeof(pthread_t));
+    for (int t = 0; t < nthreads; t++) pthread_create(&threads[t], NULL, worker, &work);
+
+    struct Aggregate total = { 0 };
+    for (int t = 0; t < nthreads; t++) {
+        struct Aggregate *partial;
+        pthread_join(threads[t], (void **)&partial);
+        merge(&total, partial);
+        free(partial);
+    }
+
+    write_outputs(&total, out);
+    fprintf(stderr, "%zu inputs, %d threads, tables in %s\n", jobs.n, nthreads, out);
+    return 0;
+}
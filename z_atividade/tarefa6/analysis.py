@@ -1,5 +1,6 @@
 import os
 import re
+import csv
 import numpy as np
 import matplotlib.pyplot as plt
 from collections import defaultdict, Counter
@@ -325,7 +326,55 @@ class PSAnalyzer:
         print("Analysis complete. Data generated for LaTeX report.")
         return summary_df
 
+def read_table(path):
+    """Rows of one of ./aggregate's CSV outputs, grouped by part"""
+    by_part = defaultdict(list)
+    with open(path, newline='') as f:
+        for row in csv.DictReader(f):
+            by_part[row['part']].append(row)
+    return by_part
+
+def plot_figures(table_dir="./latex", output_dir="./figures"):
+    """Draw the PSAnalyzer plots from ./aggregate's outputs, without the logs"""
+    os.makedirs(output_dir, exist_ok=True)
+
+    for part, rows in read_table(os.path.join(table_dir, "cpu_hist.csv")).items():
+        plt.figure(figsize=(10, 6))
+        plt.hist([float(r['cpu']) for r in rows], bins=20, weights=[int(r['samples']) for r in rows],
+                 alpha=0.7, color='blue')
+        plt.title(f'CPU Usage Distribution - Part {part}')
+        plt.xlabel('CPU Usage (%)')
+        plt.ylabel('Frequency')
+        plt.grid(True, alpha=0.3)
+        plt.savefig(os.path.join(output_dir, f'cpu_dist_part{part}.pdf'))
+        plt.close()
+
+    for part, rows in read_table(os.path.join(table_dir, "process_states.csv")).items():
+        plt.figure(figsize=(8, 6))
+        plt.bar([r['stat'] for r in rows], [int(r['samples']) for r in rows], color='green', alpha=0.7)
+        plt.title(f'Process State Distribution - Part {part}')
+        plt.xlabel('Process State')
+        plt.ylabel('Count')
+        plt.grid(True, alpha=0.3, axis='y')
+        plt.savefig(os.path.join(output_dir, f'state_dist_part{part}.pdf'))
+        plt.close()
+
+    for part, rows in read_table(os.path.join(table_dir, "priority_cpu.csv")).items():
+        plt.figure(figsize=(10, 6))
+        plt.bar([int(r['pri']) for r in rows], [float(r['mean_cpu']) for r in rows], color='purple', alpha=0.7)
+        plt.title(f'Priority vs Mean CPU Usage - Part {part}')
+        plt.xlabel('Priority (PRI)')
+        plt.ylabel('Mean CPU Usage (%)')
+        plt.grid(True, alpha=0.3, axis='y')
+        plt.savefig(os.path.join(output_dir, f'priority_cpu_part{part}.pdf'))
+        plt.close()
+
 if __name__ == "__main__":
-    analyzer = PSAnalyzer()
-    summary = analyzer.generate_report_data()
-    print(summary)
\ No newline at end of file
+    import sys
+    if "--figures" in sys.argv:
+        # Tables and the data behind the plots come from ./aggregate
+        plot_figures()
+    else:
+        analyzer = PSAnalyzer()
+        summary = analyzer.generate_report_data()
+        print(summary)
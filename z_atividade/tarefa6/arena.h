@@ -0,0 +1,252 @@
+// Allocator over a shared memfd mapping, for results built by many processes.
+//
+// Everything inside the arena refers to everything else by arena_off, the
+// byte offset from the start of the mapping, so a structure built by one
+// process reads the same in any other that maps the memfd, at whatever
+// address (fork keeps the address; mapping the fd again usually doesn't).
+// Offset 0 is the header, which doubles as the null offset.
+//
+// Blocks come in power-of-two size classes, 16 B to 16 MiB with an 8-byte
+// header that records the class; larger requests get their own bump region
+// and are never reused. Each process allocates through an ArenaCache: a
+// private chunk carved without atomics, and private free lists per class.
+// A cache that grows past ARENA_CACHE_MAX blocks in a class hands half of
+// them to the arena's shared list for that class, a Treiber stack whose
+// head carries a tag against ABA. Chunks and large blocks come from one
+// compare-and-swap bump pointer. Nothing takes a lock or makes a syscall.
+//
+// A block may be freed by any process, not only the one that allocated it.
+// Payloads are 8-byte aligned. Define _GNU_SOURCE first, for memfd_create.
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define ARENA_MAGIC 0x31414e4552413954ull   // "T9ARENA1"
+#define ARENA_NCLASSES 21                   // blocks of 16 << class bytes
+#define ARENA_LARGE 0xff                    // header class of a large block
+#define ARENA_CHUNK (64u << 10)             // bump region a cache takes at once
+#define ARENA_CACHE_MAX 64                  // free blocks a cache keeps per class
+
+typedef uint64_t arena_off;
+
+struct ArenaHeader {
+    uint64_t magic;
+    uint64_t size;                              // bytes in the mapping
+    _Atomic uint64_t top;                       // first byte never handed out
+    _Atomic arena_off root;                     // entry point for whoever maps it
+    _Atomic uint64_t free_head[ARENA_NCLASSES]; // offset / 8 | tag << 40
+};
+
+// One process' view: a private chunk and private free lists
+struct ArenaCache {
+    struct ArenaHeader *arena;
+    arena_off chunk, chunk_end;
+    arena_off free[ARENA_NCLASSES];     // linked through the payload's first word
+    uint32_t nfree[ARENA_NCLASSES];
+};
+
+#define ARENA_OFF_MASK ((1ull << 40) - 1)
+#define ARENA_TAG_ONE (1ull << 40)
+
+static inline void *arena_ptr(struct ArenaHeader *a, arena_off off) {
+    return off != 0 ? (char *)a + off : NULL;
+}
+
+static inline arena_off arena_off_of(struct ArenaHeader *a, const void *p) {
+    return p != NULL ? (arena_off)((const char *)p - (const char *)a) : 0;
+}
+
+// The header word in front of a block's payload
+static inline uint64_t *arena_block(struct ArenaHeader *a, arena_off payload) {
+    return (uint64_t *)((char *)a + payload - sizeof(uint64_t));
+}
+
+// Free-list link, stored in the payload; atomic because a process popping
+// the shared list may read it while another reuses the block
+static inline _Atomic arena_off *arena_link(struct ArenaHeader *a, arena_off payload) {
+    return (_Atomic arena_off *)((char *)a + payload);
+}
+
+// Smallest class whose blocks hold n bytes plus the header
+static inline int arena_class(size_t n) {
+    int c = 0;
+    while (c < ARENA_NCLASSES && (16ull << c) < n + sizeof(uint64_t)) c++;
+    return c;
+}
+
+// Claim bytes from the shared bump pointer; 0 when the arena is full
+static inline arena_off arena_bump(struct ArenaHeader *a, uint64_t bytes) {
+    uint64_t top = atomic_load_explicit(&a->top, memory_order_relaxed);
+    do {
+        if (bytes > a->size - top) return 0;
+    } while (!atomic_compare_exchange_weak_explicit(&a->top, &top, top + bytes, memory_order_relaxed,
+                                                    memory_order_relaxed));
+    return top;
+}
+
+static inline void arena_push_shared(struct ArenaHeader *a, int c, arena_off first, arena_off last) {
+    uint64_t head = atomic_load_explicit(&a->free_head[c], memory_order_relaxed);
+    uint64_t next;
+    do {
+        atomic_store_explicit(arena_link(a, last), (head & ARENA_OFF_MASK) << 3, memory_order_relaxed);
+        next = (first >> 3) | ((head & ~ARENA_OFF_MASK) + ARENA_TAG_ONE);
+    } while (!atomic_compare_exchange_weak_explicit(&a->free_head[c], &head, next, memory_order_release,
+                                                    memory_order_relaxed));
+}
+
+static inline arena_off arena_pop_shared(struct ArenaHeader *a, int c) {
+    uint64_t head = atomic_load_explicit(&a->free_head[c], memory_order_acquire);
+    while ((head & ARENA_OFF_MASK) != 0) {
+        arena_off off = (head & ARENA_OFF_MASK) << 3;
+        // May be stale if someone popped it meanwhile; the tag makes the CAS fail then
+        arena_off link = atomic_load_explicit(arena_link(a, off), memory_order_relaxed);
+        uint64_t next = (link >> 3) | ((head & ~ARENA_OFF_MASK) + ARENA_TAG_ONE);
+        if (atomic_compare_exchange_weak_explicit(&a->free_head[c], &head, next, memory_order_acquire,
+                                                  memory_order_acquire)) {
+            return off;
+        }
+    }
+    return 0;
+}
+
+// n bytes, uninitialized; 0 when the arena is full
+static inline arena_off arena_alloc(struct ArenaCache *cache, size_t n) {
+    struct ArenaHeader *a = cache->arena;
+    int c = arena_class(n);
+
+    if (c == ARENA_NCLASSES) {
+        uint64_t bytes = (n + sizeof(uint64_t) + 15) & ~15ull;
+        arena_off block = arena_bump(a, bytes);
+        if (block == 0) return 0;
+        *(uint64_t *)((char *)a + block) = bytes << 8 | ARENA_LARGE;
+        return block + sizeof(uint64_t);
+    }
+
+    arena_off payload = cache->free[c];
+    if (payload != 0) {
+        cache->free[c] = atomic_load_explicit(arena_link(a, payload), memory_order_relaxed);
+        cache->nfree[c]--;
+        return payload;
+    }
+    payload = arena_pop_shared(a, c);
+    if (payload != 0) return payload;
+
+    uint64_t bytes = 16ull << c;
+    if (cache->chunk_end - cache->chunk < bytes) {
+        // The old chunk's tail is too small for this class and is dropped
+        uint64_t size = bytes > ARENA_CHUNK ? bytes : ARENA_CHUNK;
+        arena_off chunk = arena_bump(a, size);
+        if (chunk == 0) chunk = arena_bump(a, size = bytes);
+        if (chunk == 0) return 0;
+        cache->chunk = chunk;
+        cache->chunk_end = chunk + size;
+    }
+    arena_off block = cache->chunk;
+    cache->chunk += bytes;
+    *(uint64_t *)((char *)a + block) = (uint64_t)c;
+    return block + sizeof(uint64_t);
+}
+
+static inline void arena_free(struct ArenaCache *cache, arena_off payload) {
+    if (payload == 0) return;
+    struct ArenaHeader *a = cache->arena;
+    int c = *arena_block(a, payload) & 0xff;
+    if (c == ARENA_LARGE) return;
+
+    atomic_store_explicit(arena_link(a, payload), cache->free[c], memory_order_relaxed);
+    cache->free[c] = payload;
+    if (++cache->nfree[c] <= ARENA_CACHE_MAX) return;
+
+    // Give the older half back, so other processes can reuse it
+    arena_off last = payload;
+    for (uint32_t k = 1; k < ARENA_CACHE_MAX / 2; k++) {
+        last = atomic_load_explicit(arena_link(a, last), memory_order_relaxed);
+    }
+    arena_off rest = atomic_load_explicit(arena_link(a, last), memory_order_relaxed);
+    atomic_store_explicit(arena_link(a, last), 0, memory_order_relaxed);
+    cache->nfree[c] = ARENA_CACHE_MAX / 2;
+    arena_off tail = rest;
+    while (atomic_load_explicit(arena_link(a, tail), memory_order_relaxed) != 0) {
+        tail = atomic_load_explicit(arena_link(a, tail), memory_order_relaxed);
+    }
+    arena_push_shared(a, c, rest, tail);
+}
+
+// Hand every privately cached block back to the shared lists
+static inline void arena_cache_flush(struct ArenaCache *cache) {
+    struct ArenaHeader *a = cache->arena;
+    for (int c = 0; c < ARENA_NCLASSES; c++) {
+        if (cache->free[c] == 0) continue;
+        arena_off tail = cache->free[c];
+        while (atomic_load_explicit(arena_link(a, tail), memory_order_relaxed) != 0) {
+            tail = atomic_load_explicit(arena_link(a, tail), memory_order_relaxed);
+        }
+        arena_push_shared(a, c, cache->free[c], tail);
+        cache->free[c] = 0;
+        cache->nfree[c] = 0;
+    }
+}
+
+// Start a cache from scratch. A forked child must do this before its first
+// allocation: the one it inherited describes blocks its parent still owns.
+static inline void arena_cache_init(struct ArenaCache *cache, struct ArenaHeader *a) {
+    memset(cache, 0, sizeof(*cache));
+    cache->arena = a;
+}
+
+// Map an arena by its memfd, e.g. one inherited across exec
+static inline struct ArenaHeader *arena_map(int fd) {
+    struct stat st;
+    if (fstat(fd, &st) == -1) {
+        perror("fstat arena");
+        return NULL;
+    }
+    struct ArenaHeader *a = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (a == MAP_FAILED) {
+        perror("mmap arena");
+        return NULL;
+    }
+    if ((size_t)st.st_size < sizeof(*a) || a->magic != ARENA_MAGIC || a->size != (uint64_t)st.st_size) {
+        fprintf(stderr, "fd %d: not an arena\n", fd);
+        munmap(a, st.st_size);
+        return NULL;
+    }
+    return a;
+}
+
+// New arena of size bytes on a fresh memfd, returned in *fd. Pages are
+// only backed once touched, so sizing for the worst case is cheap.
+static inline struct ArenaHeader *arena_create(const char *name, size_t size, int *fd) {
+    *fd = memfd_create(name, MFD_CLOEXEC);
+    if (*fd == -1 || ftruncate(*fd, size) == -1) {
+        perror("memfd arena");
+        if (*fd != -1) close(*fd);
+        return NULL;
+    }
+    struct ArenaHeader *a = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, *fd, 0);
+    if (a == MAP_FAILED) {
+        perror("mmap arena");
+        close(*fd);
+        return NULL;
+    }
+    a->magic = ARENA_MAGIC;
+    a->size = size;
+    atomic_store(&a->top, (sizeof(*a) + 15) & ~(uint64_t)15);
+    atomic_store(&a->root, 0);
+    for (int c = 0; c < ARENA_NCLASSES; c++) atomic_store(&a->free_head[c], 0);
+    return a;
+}
+
+static inline void arena_destroy(struct ArenaHeader *a, int fd) {
+    munmap(a, a->size);
+    if (fd != -1) close(fd);
+}
+
+#endif
@@ -0,0 +1,237 @@
+// Benchmark and cross-process check for the allocator in arena.h.
+//
+// Forked workers share one arena. Each one allocates and frees blocks of
+// random sizes (now and then one above the largest class, and one such block
+// held for the whole run), fills every block with a pattern of its owner and
+// sequence number and checks it before freeing.
+// The survivors are linked into a list per worker with offset pointers
+// and published in the arena's root. The parent then maps the memfd a
+// second time, at another address, walks every list through that mapping,
+// frees all of it (blocks it never allocated) and allocates them again to
+// see the free lists reused instead of the bump pointer. The same loop with
+// malloc/free in each worker gives the private-heap baseline.
+//
+// Usage: ./arenabench [processes] [operations per process]
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#include "arena.h"
+
+#define LIVE 1024                       // blocks a worker holds at most
+#define LARGE_SIZE ((16u << 20) + 4096) // just past the largest class
+#define ARENA_BYTES (1ull << 30)
+
+struct Node {
+    arena_off next;
+    uint32_t owner, seq;
+    uint32_t size;                      // bytes in data
+    unsigned char data[];
+};
+
+struct Results {
+    uint32_t nworkers;
+    _Atomic arena_off lists[];          // survivors of worker w
+};
+
+static double now_s(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static uint64_t xorshift(uint64_t *s) {
+    *s ^= *s << 13;
+    *s ^= *s >> 7;
+    *s ^= *s << 17;
+    return *s;
+}
+
+static uint32_t random_size(uint64_t *s) {
+    // Mostly small records, sometimes one in the larger classes, and
+    // rarely one past the largest class
+    uint64_t r = xorshift(s) % 200000;
+    if (r == 0) return LARGE_SIZE;
+    return r < 200 ? 100000 : xorshift(s) % 1000;
+}
+
+static void fill(struct Node *n, uint32_t owner, uint32_t seq, uint32_t size) {
+    n->next = 0;
+    n->owner = owner;
+    n->seq = seq;
+    n->size = size;
+    memset(n->data, (owner * 31 + seq) & 0xff, size);
+}
+
+static bool intact(const struct Node *n) {
+    unsigned char want = (n->owner * 31 + n->seq) & 0xff;
+    for (uint32_t k = 0; k < n->size; k++) {
+        if (n->data[k] != want) return false;
+    }
+    return true;
+}
+
+// Worker w's loop on the arena; returns blocks found corrupted
+uint64_t arena_worker(struct ArenaHeader *a, struct Results *res, uint32_t w, long ops) {
+    struct ArenaCache cache;
+    arena_cache_init(&cache, a);
+    arena_off *live = malloc(LIVE * sizeof(arena_off));
+    int nlive = 0;
+    uint64_t seed = 0x9e3779b97f4a7c15ull * (w + 1), corrupt = 0;
+
+    // A large block from the bump pointer that survives the run, so the
+    // parent always finds one through its own mapping
+    arena_off held = arena_alloc(&cache, sizeof(struct Node) + LARGE_SIZE);
+    if (held != 0) fill(arena_ptr(a, held), w, UINT32_MAX, LARGE_SIZE);
+
+    for (long i = 0; i < ops; i++) {
+        if (nlive == 0 || (nlive < LIVE && xorshift(&seed) % 2 == 0)) {
+            uint32_t size = random_size(&seed);
+            arena_off off = arena_alloc(&cache, sizeof(struct Node) + size);
+            if (off == 0) break;
+            fill(arena_ptr(a, off), w, i, size);
+            live[nlive++] = off;
+        } else {
+            int k = xorshift(&seed) % nlive;
+            if (!intact(arena_ptr(a, live[k]))) corrupt++;
+            arena_free(&cache, live[k]);
+            live[k] = live[--nlive];
+        }
+    }
+
+    // Publish the survivors as a list the parent can walk
+    arena_off head = held;
+    for (int k = 0; k < nlive; k++) {
+        struct Node *n = arena_ptr(a, live[k]);
+        n->next = head;
+        head = live[k];
+    }
+    atomic_store_explicit(&res->lists[w], head, memory_order_release);
+    arena_cache_flush(&cache);
+    free(live);
+    return corrupt;
+}
+
+// The same operations on this process' own heap
+uint64_t malloc_worker(uint32_t w, long ops) {
+    struct Node **live = malloc(LIVE * sizeof(struct Node *));
+    int nlive = 0;
+    uint64_t seed = 0x9e3779b97f4a7c15ull * (w + 1), corrupt = 0;
+
+    for (long i = 0; i < ops; i++) {
+        if (nlive == 0 || (nlive < LIVE && xorshift(&seed) % 2 == 0)) {
+            uint32_t size = random_size(&seed);
+            struct Node *n = malloc(sizeof(struct Node) + size);
+            fill(n, w, i, size);
+            live[nlive++] = n;
+        } else {
+            int k = xorshift(&seed) % nlive;
+            if (!intact(live[k])) corrupt++;
+            free(live[k]);
+            live[k] = live[--nlive];
+        }
+    }
+    while (nlive > 0) free(live[--nlive]);
+    free(live);
+    return corrupt;
+}
+
+// Fork nworkers running one of the loops, wait for them; returns wall seconds
+double run(bool arena, struct ArenaHeader *a, struct Results *res, int nworkers, long ops, int *failed) {
+    double start = now_s();
+    for (int w = 0; w < nworkers; w++) {
+        fflush(stdout);
+        pid_t pid = fork();
+        if (pid == 0) {
+            uint64_t corrupt = arena ? arena_worker(a, res, w, ops) : malloc_worker(w, ops);
+            if (corrupt) fprintf(stderr, "worker %d: %llu corrupted blocks\n", w, (unsigned long long)corrupt);
+            exit(corrupt ? 1 : 0);
+        } else if (pid == -1) {
+            perror("fork");
+            (*failed)++;
+        }
+    }
+    int status;
+    while (wait(&status) > 0) {
+        if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) (*failed)++;
+    }
+    return now_s() - start;
+}
+
+int main(int argc, char *argv[]) {
+    int nworkers = argc > 1 ? atoi(argv[1]) : 4;
+    long ops = argc > 2 ? atol(argv[2]) : 1000000;
+    if (nworkers < 1) nworkers = 1;
+
+    int fd;
+    struct ArenaHeader *a = arena_create("t9_arenabench", ARENA_BYTES, &fd);
+    if (a == NULL) return EXIT_FAILURE;
+    struct ArenaCache cache;
+    arena_cache_init(&cache, a);
+    arena_off root = arena_alloc(&cache, sizeof(struct Results) + nworkers * sizeof(arena_off));
+    struct Results *res = arena_ptr(a, root);
+    res->nworkers = nworkers;
+    for (int w = 0; w < nworkers; w++) atomic_store(&res->lists[w], 0);
+    atomic_store(&a->root, root);
+
+    printf("%ld CPU(s), %d worker(s), %ld operations each\n", sysconf(_SC_NPROCESSORS_ONLN), nworkers, ops);
+    printf("%-8s %14s %10s\n", "heap", "ops/s", "failed");
+    int failed = 0;
+    double wall = run(false, NULL, NULL, nworkers, ops, &failed);
+    printf("%-8s %14.0f %10d\n", "malloc", nworkers * ops / wall, failed);
+    failed = 0;
+    wall = run(true, a, res, nworkers, ops, &failed);
+    printf("%-8s %14.0f %10d\n", "arena", nworkers * ops / wall, failed);
+
+    // Walk the workers' lists through a second mapping of the memfd
+    struct ArenaHeader *b = arena_map(fd);
+    if (b == NULL) return EXIT_FAILURE;
+    struct Results *seen = arena_ptr(b, atomic_load(&b->root));
+    uint64_t nodes = 0, bad = 0, bytes = 0;
+    for (uint32_t w = 0; w < seen->nworkers; w++) {
+        for (arena_off off = atomic_load(&seen->lists[w]); off != 0;) {
+            struct Node *n = arena_ptr(b, off);
+            if (n->owner != w || !intact(n)) bad++;
+            nodes++;
+            bytes += sizeof(struct Node) + n->size;
+            off = n->next;
+        }
+    }
+    uint64_t top = atomic_load(&a->top);
+    printf("%llu surviving blocks (%.1f KiB) read at a second address (%p vs %p), %llu bad; %.1f MiB bumped\n",
+           (unsigned long long)nodes, bytes / 1024.0, (void *)b, (void *)a, (unsigned long long)bad,
+           top / 1048576.0);
+
+    // Free what the workers left, then allocate the same sizes again: the
+    // free lists should absorb them, not the bump pointer
+    uint32_t *sizes = malloc((nodes + 1) * sizeof(uint32_t));
+    uint64_t nsizes = 0;
+    for (uint32_t w = 0; w < seen->nworkers; w++) {
+        for (arena_off off = atomic_load(&seen->lists[w]); off != 0;) {
+            struct Node *n = arena_ptr(a, off);
+            arena_off next = n->next;
+            sizes[nsizes++] = n->size;
+            arena_free(&cache, off);
+            off = next;
+        }
+    }
+    top = atomic_load(&a->top);
+    uint64_t large = 0;
+    for (uint64_t k = 0; k < nsizes; k++) {
+        if (arena_class(sizeof(struct Node) + sizes[k]) == ARENA_NCLASSES) large += sizeof(struct Node) + sizes[k];
+        arena_alloc(&cache, sizeof(struct Node) + sizes[k]);
+    }
+    printf("reallocating them bumped %.1f KiB more (%.1f KiB of it large blocks, which are not reused)\n",
+           (atomic_load(&a->top) - top) / 1024.0, large / 1024.0);
+    free(sizes);
+
+    munmap(b, b->size);
+    arena_destroy(a, fd);
+    return bad || failed ? EXIT_FAILURE : 0;
+}
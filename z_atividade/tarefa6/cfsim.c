@@ -0,0 +1,749 @@
+// Discrete-event simulator of the Linux fair scheduler for tarefa6 parts.
+//
+// Replays the same experiment descriptions spawn runs (how many hogs, their
+// nice values, tasks blocked on input, periodic sleepers) on C virtual CPUs
+// with per-CPU run queues, weight-scaled vruntime, EEVDF's eligibility and
+// virtual deadlines (or CFS's min-vruntime pick with -m cfs), wakeup
+// placement and periodic load balancing. Observations are taken on spawn's
+// schedule and written as a binary sample log, so ./aggregate turns them
+// into the same tables as a real run.
+//
+// Usage: ./cfsim [-p CPUS] [-m eevdf|cfs] [-o DIR] [PART...]   simulate, write DIR/samples.bin
+//        ./cfsim [-p CPUS] [-m eevdf|cfs] -c [LOGDIR]         predict LOGDIR/samples.bin's parts
+//        ./cfsim -b COUNT                                      time COUNT random configurations
+//
+// PART is a comma-separated list: part=X,hogs=N,nice=INDEX:NICE (repeatable),
+// blocked=N,sleepers=N:RUN_US:SLEEP_US,no=OBSERVATIONS,io=MS, where RUN_US
+// and SLEEP_US are positive. Without PART arguments the four tarefa6 parts
+// are simulated for N = CPUS.
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <sched.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "samplelog.h"
+
+#define SETTLE_MS 500           // spawn's delay before the first observation
+#define BALANCE_NS 4000000ull   // periodic load balancing
+#define CLK_TCK 100
+#define MAX_TASKS 65536
+
+// Kernel's sched_prio_to_weight, nice -20..19
+static const uint32_t nice_weight[40] = {
+    88761, 71755, 56483, 46273, 36291, 29154, 23254, 18705, 14949, 11916,
+    9548,  7620,  6100,  4904,  3906,  3121,  2501,  1991,  1586,  1277,
+    1024,  820,   655,   526,   423,   335,   272,   215,   172,   137,
+    110,   87,    70,    56,    45,    36,    29,    23,    18,    15,
+};
+
+enum Kind { HOG, BLOCKED, SLEEPER };
+enum Mode { EEVDF, CFS };
+
+// One part, as spawn would run it
+struct Config {
+    char part;
+    int hogs;
+    int blocked;
+    int sleepers;
+    uint64_t run_us, sleep_us;  // sleepers' burst and nap
+    int no;                     // observations
+    uint64_t io_ms;             // between observations
+    int nnice;
+    struct { int index, nice; } nice[64];
+};
+
+struct Task {
+    enum Kind kind;
+    int nice;
+    uint32_t weight;
+    int cpu;
+    bool runnable;
+    double vruntime;
+    double deadline;            // EEVDF virtual deadline
+    double lag;                 // at sleep: V - vruntime (EEVDF) or the queue min_vruntime (CFS)
+    uint64_t burst_left;        // sleepers: CPU time until the next nap
+    uint64_t wake_at;           // sleepers: end of the current nap
+    uint64_t runnable_since;    // start of the current wait on a run queue
+    uint64_t sum_exec, wait_ns, slices, vcsw, nvcsw, migrations;
+};
+
+struct Cpu {
+    int curr;                   // -1 when idle
+    uint64_t slice_end;         // when curr must be rescheduled
+    int nr;                     // runnable tasks queued here, curr included
+    int *rq;
+    double min_vruntime;        // CFS wakeup placement
+};
+
+struct Sim {
+    enum Mode mode;
+    int ncpu;
+    struct Cpu *cpus;
+    struct Task *tasks;
+    int ntasks;
+    uint64_t now;
+    double base_slice;          // ns, scaled with the CPU count like the kernel's
+    double latency;             // CFS sched_latency
+    double wakeup_gran;         // CFS wakeup granularity
+};
+
+// ---- run queues ----
+
+static double avg_vruntime(struct Sim *s, struct Cpu *c) {
+    double sum = 0, w = 0;
+    for (int k = 0; k < c->nr; k++) {
+        struct Task *t = &s->tasks[c->rq[k]];
+        sum += t->vruntime * t->weight;
+        w += t->weight;
+    }
+    return w > 0 ? sum / w : c->min_vruntime;
+}
+
+static double queue_min_vruntime(struct Sim *s, struct Cpu *c) {
+    double v = INFINITY;
+    for (int k = 0; k < c->nr; k++) {
+        if (s->tasks[c->rq[k]].vruntime < v) v = s->tasks[c->rq[k]].vruntime;
+    }
+    return v == INFINITY ? c->min_vruntime : v;
+}
+
+static double load(struct Sim *s, struct Cpu *c) {
+    double w = 0;
+    for (int k = 0; k < c->nr; k++) w += s->tasks[c->rq[k]].weight;
+    return w;
+}
+
+static void enqueue(struct Sim *s, int cpu, int id) {
+    struct Cpu *c = &s->cpus[cpu];
+    struct Task *t = &s->tasks[id];
+    c->rq[c->nr++] = id;
+    t->cpu = cpu;
+    t->runnable = true;
+    t->runnable_since = s->now;
+}
+
+static void dequeue(struct Sim *s, int id) {
+    struct Task *t = &s->tasks[id];
+    struct Cpu *c = &s->cpus[t->cpu];
+    for (int k = 0; k < c->nr; k++) {
+        if (c->rq[k] == id) {
+            c->rq[k] = c->rq[--c->nr];
+            break;
+        }
+    }
+    if (c->curr == id) c->curr = -1;
+    t->runnable = false;
+}
+
+// Pick what runs next on cpu and until when
+static void schedule(struct Sim *s, int cpu) {
+    struct Cpu *c = &s->cpus[cpu];
+    int prev = c->curr;
+    c->min_vruntime = fmax(c->min_vruntime, queue_min_vruntime(s, c));
+    if (c->nr == 0) {
+        c->curr = -1;
+        return;
+    }
+
+    int next = -1;
+    if (s->mode == EEVDF) {
+        // Earliest virtual deadline among the eligible (not ahead of V)
+        double V = avg_vruntime(s, c);
+        for (int k = 0; k < c->nr; k++) {
+            struct Task *t = &s->tasks[c->rq[k]];
+            if (t->vruntime > V + 1e-6) continue;
+            if (next == -1 || t->deadline < s->tasks[next].deadline) next = c->rq[k];
+        }
+    }
+    if (next == -1) {
+        for (int k = 0; k < c->nr; k++) {
+            if (next == -1 || s->tasks[c->rq[k]].vruntime < s->tasks[next].vruntime) next = c->rq[k];
+        }
+    }
+
+    struct Task *t = &s->tasks[next];
+    double slice;
+    if (s->mode == EEVDF) {
+        // A used-up request gets a new slice and deadline
+        if (t->vruntime >= t->deadline - 1e-6) {
+            t->deadline = t->vruntime + s->base_slice * 1024 / t->weight;
+            t->slices++;
+        }
+        slice = (t->deadline - t->vruntime) * t->weight / 1024;
+    } else {
+        double period = fmax(s->latency, c->nr * s->base_slice);
+        slice = fmax(period * t->weight / load(s, c), s->base_slice);
+        if (next != prev) t->slices++;
+    }
+    if (t->kind == SLEEPER && t->burst_left < slice) slice = t->burst_left;
+
+    if (prev != next) {
+        if (prev != -1 && s->tasks[prev].runnable) {
+            s->tasks[prev].nvcsw++;
+            s->tasks[prev].runnable_since = s->now;
+        }
+        t->wait_ns += s->now - t->runnable_since;
+    }
+    c->curr = next;
+    c->slice_end = s->now + (uint64_t)ceil(slice);
+}
+
+// Put a waking sleeper back, on an idle CPU if there is one
+static void wake(struct Sim *s, int id, uint64_t burst_ns) {
+    struct Task *t = &s->tasks[id];
+    int cpu = t->cpu;
+    if (s->cpus[cpu].nr > 0) {
+        for (int k = 0; k < s->ncpu; k++) {
+            if (s->cpus[k].nr == 0) {
+                cpu = k;
+                break;
+            }
+        }
+    }
+    struct Cpu *c = &s->cpus[cpu];
+
+    if (s->mode == EEVDF) {
+        t->vruntime = avg_vruntime(s, c) - t->lag;
+        t->deadline = t->vruntime + s->base_slice * 1024 / t->weight;
+    } else {
+        t->vruntime = fmax(t->vruntime + queue_min_vruntime(s, c) - t->lag, queue_min_vruntime(s, c) - s->latency / 2);
+    }
+    t->burst_left = burst_ns;
+    enqueue(s, cpu, id);
+
+    // Wakeup preemption
+    if (c->curr == -1) {
+        schedule(s, cpu);
+        return;
+    }
+    struct Task *curr = &s->tasks[c->curr];
+    bool preempt = s->mode == EEVDF ? t->vruntime <= avg_vruntime(s, c) && t->deadline < curr->deadline
+                                    : curr->vruntime - t->vruntime > s->wakeup_gran;
+    if (preempt) schedule(s, cpu);
+}
+
+static void nap(struct Sim *s, int id, uint64_t sleep_ns) {
+    struct Task *t = &s->tasks[id];
+    struct Cpu *c = &s->cpus[t->cpu];
+    // What wake() needs to put it back fairly
+    t->lag = s->mode == EEVDF ? avg_vruntime(s, c) - t->vruntime : queue_min_vruntime(s, c);
+    if (s->mode == EEVDF) {
+        double limit = 2 * s->base_slice * 1024 / t->weight;
+        t->lag = fmax(-limit, fmin(limit, t->lag));
+    }
+    dequeue(s, id);
+    t->vcsw++;
+    t->wake_at = s->now + sleep_ns;
+    schedule(s, t->cpu);
+}
+
+// Move tasks from the most to the least loaded CPU while that evens them out
+static void balance(struct Sim *s) {
+    for (int moves = 0; moves < s->ncpu; moves++) {
+        int busiest = 0, idlest = 0;
+        double lb = load(s, &s->cpus[0]), li = lb;
+        for (int k = 1; k < s->ncpu; k++) {
+            double l = load(s, &s->cpus[k]);
+            if (l > lb) busiest = k, lb = l;
+            if (l < li) idlest = k, li = l;
+        }
+        if (busiest == idlest) return;
+
+        struct Cpu *from = &s->cpus[busiest], *to = &s->cpus[idlest];
+        int pick = -1;
+        for (int k = 0; k < from->nr; k++) {
+            int id = from->rq[k];
+            if (id != from->curr && lb - li >= 2.0 * s->tasks[id].weight) {
+                pick = id;
+                break;
+            }
+        }
+        if (pick == -1) return;
+
+        struct Task *t = &s->tasks[pick];
+        double shift = s->mode == EEVDF ? avg_vruntime(s, to) - avg_vruntime(s, from)
+                                        : queue_min_vruntime(s, to) - queue_min_vruntime(s, from);
+        uint64_t waited = s->now - t->runnable_since;
+        dequeue(s, pick);
+        t->vruntime += shift;
+        t->deadline += shift;
+        enqueue(s, idlest, pick);
+        t->runnable_since = s->now - waited;
+        t->migrations++;
+        if (to->curr == -1) schedule(s, idlest);
+    }
+}
+
+// Charge delta ns to every running task
+static void advance(struct Sim *s, uint64_t to) {
+    uint64_t delta = to - s->now;
+    for (int k = 0; k < s->ncpu; k++) {
+        int id = s->cpus[k].curr;
+        if (id == -1) continue;
+        struct Task *t = &s->tasks[id];
+        t->sum_exec += delta;
+        t->vruntime += (double)delta * 1024 / t->weight;
+        if (t->kind == SLEEPER) t->burst_left = t->burst_left > delta ? t->burst_left - delta : 0;
+    }
+    s->now = to;
+}
+
+// ---- one part ----
+
+struct Sink {
+    struct SampleLogHeader *log;    // NULL: don't record
+    uint64_t capacity;
+    double *final_cpu;              // ps %CPU of every task at the last observation
+    double *sum_cpu;                // and summed over all observations
+    int *running_obs;               // observations in state R
+};
+
+static void observe(struct Sim *s, const struct Config *cfg, int obs, struct Sink *sink) {
+    for (int id = 0; id < s->ntasks; id++) {
+        struct Task *t = &s->tasks[id];
+        double cpu = s->now ? (double)(t->sum_exec / (1000000000ull / CLK_TCK)) / CLK_TCK / (s->now / 1e9) * 100 : 0;
+        cpu = round(cpu * 10) / 10;
+        if (sink->final_cpu) sink->final_cpu[id] = cpu;
+        if (sink->sum_cpu) sink->sum_cpu[id] += cpu;
+        if (sink->running_obs && t->runnable) sink->running_obs[id]++;
+
+        if (sink->log == NULL) continue;
+        uint64_t i = atomic_fetch_add(&sink->log->count, 1);
+        if (i >= sink->capacity) continue;
+        struct SampleRecord *r = (struct SampleRecord *)((char *)sink->log + SAMPLELOG_DATA_OFFSET) + i;
+        memset(r, 0, sizeof(*r));
+        r->t_ns = s->now;
+        r->run_ns = t->sum_exec;
+        r->wait_ns = t->wait_ns;
+        r->slices = t->slices;
+        r->starttime = sink->log->base_boottime_ns / (1000000000ull / CLK_TCK);
+        r->utime = t->sum_exec / (1000000000ull / CLK_TCK);
+        r->vcsw = t->vcsw;
+        r->nvcsw = t->nvcsw;
+        r->pid = 1000 + id;
+        r->observation = obs;
+        r->cpu = t->cpu;
+        r->part = cfg->part;
+        r->state = t->runnable ? 'R' : 'S';
+        r->nice = t->nice;
+        r->priority = 20 + t->nice;
+        r->threads = 1;
+        snprintf(r->comm, sizeof(r->comm), "%s",
+                 t->kind == HOG ? "t9_monotono" : t->kind == BLOCKED ? "t9_blocking_io" : "t9_sleeper");
+        r->task_clock_ns = t->sum_exec;
+        r->context_switches = t->vcsw + t->nvcsw;
+        r->cpu_migrations = t->migrations;
+    }
+}
+
+static int config_tasks(const struct Config *cfg) {
+    return cfg->hogs + cfg->blocked + cfg->sleepers;
+}
+
+void simulate(enum Mode mode, int ncpu, const struct Config *cfg, struct Sink *sink) {
+    struct Sim s = { .mode = mode, .ncpu = ncpu };
+    // sysctl_sched_base_slice and sched_latency scale with 1 + ilog2(min(cpus, 8))
+    int factor = 1;
+    for (int n = ncpu < 8 ? ncpu : 8; n > 1; n >>= 1) factor++;
+    s.base_slice = 750000.0 * factor;
+    s.latency = 6000000.0 * factor;
+    s.wakeup_gran = 1000000.0 * factor;
+
+    s.ntasks = config_tasks(cfg);
+    s.tasks = calloc(s.ntasks, sizeof(struct Task));
+    s.cpus = calloc(ncpu, sizeof(struct Cpu));
+    for (int k = 0; k < ncpu; k++) {
+        s.cpus[k].curr = -1;
+        s.cpus[k].rq = malloc(s.ntasks * sizeof(int));
+    }
+
+    // Hogs first, in slot order, like spawn forks them
+    for (int id = 0; id < s.ntasks; id++) {
+        struct Task *t = &s.tasks[id];
+        t->kind = id < cfg->hogs ? HOG : id < cfg->hogs + cfg->blocked ? BLOCKED : SLEEPER;
+        for (int k = 0; k < cfg->nnice; k++) {
+            if (cfg->nice[k].index == id) t->nice = cfg->nice[k].nice;
+        }
+        t->weight = nice_weight[t->nice + 20];
+        t->cpu = id % ncpu;
+    }
+
+    // Fork balancing: each new task goes to the least loaded CPU
+    for (int id = 0; id < s.ntasks; id++) {
+        struct Task *t = &s.tasks[id];
+        if (t->kind == BLOCKED) continue;
+        int best = 0;
+        for (int k = 1; k < ncpu; k++) {
+            if (load(&s, &s.cpus[k]) < load(&s, &s.cpus[best])) best = k;
+        }
+        t->vruntime = avg_vruntime(&s, &s.cpus[best]);
+        t->burst_left = cfg->run_us * 1000;
+        enqueue(&s, best, id);
+    }
+    for (int k = 0; k < ncpu; k++) schedule(&s, k);
+
+    uint64_t io = cfg->io_ms * 1000000ull;
+    uint64_t next_obs = SETTLE_MS * 1000000ull, next_balance = BALANCE_NS;
+    int obs = 0;
+    while (obs < cfg->no) {
+        // Next event: an observation, a balance tick, a slice or burst ending, a wakeup
+        uint64_t t = next_obs < next_balance ? next_obs : next_balance;
+        for (int k = 0; k < ncpu; k++) {
+            if (s.cpus[k].curr != -1 && s.cpus[k].slice_end < t) t = s.cpus[k].slice_end;
+        }
+        for (int id = cfg->hogs + cfg->blocked; id < s.ntasks; id++) {
+            if (!s.tasks[id].runnable && s.tasks[id].wake_at < t) t = s.tasks[id].wake_at;
+        }
+        if (t < s.now) t = s.now;
+        advance(&s, t);
+
+        for (int id = cfg->hogs + cfg->blocked; id < s.ntasks; id++) {
+            struct Task *task = &s.tasks[id];
+            if (task->runnable && task->burst_left == 0 && s.cpus[task->cpu].curr == id) {
+                nap(&s, id, cfg->sleep_us * 1000);
+            } else if (!task->runnable && task->wake_at <= s.now) {
+                wake(&s, id, cfg->run_us * 1000);
+            }
+        }
+        for (int k = 0; k < ncpu; k++) {
+            if (s.cpus[k].curr != -1 && s.cpus[k].slice_end <= s.now) schedule(&s, k);
+        }
+        if (s.now >= next_balance) {
+            balance(&s);
+            next_balance += BALANCE_NS;
+        }
+        if (s.now >= next_obs) {
+            observe(&s, cfg, obs++, sink);
+            next_obs += io;
+        }
+    }
+
+    for (int k = 0; k < ncpu; k++) free(s.cpus[k].rq);
+    free(s.cpus);
+    free(s.tasks);
+}
+
+// ---- configurations ----
+
+static struct Config default_config(char part, int hogs) {
+    return (struct Config){ .part = part, .hogs = hogs, .no = 10, .io_ms = 500 };
+}
+
+// spawn's parts 1-4 for n CPUs
+static int tarefa6_parts(int n, struct Config *out) {
+    out[0] = default_config('1', n);
+    out[1] = default_config('2', n + 1);
+    out[2] = default_config('3', n + 1);
+    out[2].nnice = 1;
+    out[2].nice[0].index = 5 < n + 1 ? 5 : n;
+    out[2].nice[0].nice = -10;
+    out[3] = default_config('4', n);
+    out[3].blocked = 1;
+    return 4;
+}
+
+static int parse_config(const char *spec, struct Config *cfg) {
+    *cfg = default_config('x', 1);
+    char buf[1024];
+    snprintf(buf, sizeof(buf), "%s", spec);
+    for (char *tok = strtok(buf, ","); tok != NULL; tok = strtok(NULL, ",")) {
+        char *v = strchr(tok, '=');
+        if (v == NULL) return -1;
+        *v++ = '\0';
+        if (strcmp(tok, "part") == 0) cfg->part = v[0];
+        else if (strcmp(tok, "hogs") == 0) cfg->hogs = atoi(v);
+        else if (strcmp(tok, "blocked") == 0) cfg->blocked = atoi(v);
+        else if (strcmp(tok, "no") == 0) cfg->no = atoi(v);
+        else if (strcmp(tok, "io") == 0) cfg->io_ms = strtoull(v, NULL, 10);
+        else if (strcmp(tok, "sleepers") == 0) {
+            unsigned long long run, nap;
+            if (sscanf(v, "%d:%llu:%llu", &cfg->sleepers, &run, &nap) != 3) return -1;
+            // A zero burst or nap would never let simulated time advance
+            if (cfg->sleepers < 0 || run == 0 || nap == 0) return -1;
+            cfg->run_us = run;
+            cfg->sleep_us = nap;
+        } else if (strcmp(tok, "nice") == 0 && cfg->nnice < 64) {
+            if (sscanf(v, "%d:%d", &cfg->nice[cfg->nnice].index, &cfg->nice[cfg->nnice].nice) != 2) return -1;
+            if (cfg->nice[cfg->nnice].nice < -20 || cfg->nice[cfg->nnice].nice > 19) return -1;
+            cfg->nnice++;
+        } else {
+            return -1;
+        }
+    }
+    return config_tasks(cfg) > 0 && config_tasks(cfg) <= MAX_TASKS && cfg->no > 0 ? 0 : -1;
+}
+
+// ---- outputs ----
+
+struct SampleLogHeader *create_log(const char *dir, uint64_t capacity, int *fd) {
+    char path[4096];
+    mkdir(dir, 0755);
+    snprintf(path, sizeof(path), "%s/samples.bin", dir);
+    size_t bytes = SAMPLELOG_DATA_OFFSET + capacity * sizeof(struct SampleRecord);
+    *fd = open(path, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (*fd == -1 || ftruncate(*fd, bytes) == -1) {
+        perror(path);
+        return NULL;
+    }
+    struct SampleLogHeader *h = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, *fd, 0);
+    if (h == MAP_FAILED) {
+        perror("mmap");
+        return NULL;
+    }
+    memcpy(h->magic, SAMPLELOG_MAGIC, sizeof(h->magic));
+    h->version = SAMPLELOG_VERSION;
+    h->record_size = sizeof(struct SampleRecord);
+    h->experiment_id = 0x51ull << 56 | (uint64_t)time(NULL);
+    // Simulated tasks start at 100 s of uptime, the clocks at zero
+    h->base_boottime_ns = 100000000000ull;
+    h->clk_tck = CLK_TCK;
+    h->capacity = capacity;
+    snprintf(h->workload, sizeof(h->workload), "simulated");
+    return h;
+}
+
+static void print_part(const struct Config *cfg, int ncpu, struct Sink *sink) {
+    int n = config_tasks(cfg);
+    double sum = 0, lo = INFINITY, hi = -INFINITY;
+    for (int id = 0; id < n; id++) {
+        sum += sink->final_cpu[id];
+        if (sink->final_cpu[id] < lo) lo = sink->final_cpu[id];
+        if (sink->final_cpu[id] > hi) hi = sink->final_cpu[id];
+    }
+    printf("Part %c: %d tasks on %d CPUs, %%CPU mean %.1f min %.1f max %.1f", cfg->part, n, ncpu, sum / n, lo, hi);
+    for (int k = 0; k < cfg->nnice; k++) {
+        if (cfg->nice[k].index < n) {
+            printf(", task %d (nice %d) %.1f", cfg->nice[k].index, cfg->nice[k].nice, sink->final_cpu[cfg->nice[k].index]);
+        }
+    }
+    printf("\n");
+}
+
+// ---- comparison with a measured run ----
+
+struct Measured {
+    int32_t pid;
+    int nice;
+    int running;                // observations in state R
+    int observations;
+    double sum_cpu;
+    double final_cpu;
+};
+
+static int compare_pid(const void *a, const void *b) {
+    return ((const struct Measured *)a)->pid - ((const struct Measured *)b)->pid;
+}
+
+// Rebuild each part of LOGDIR/samples.bin as a Config, simulate it and put
+// the per-process %CPU next to what was measured
+int compare(enum Mode mode, int ncpu, const char *logdir) {
+    char path[4096];
+    snprintf(path, sizeof(path), "%s/samples.bin", logdir);
+    int fd = open(path, O_RDONLY);
+    struct stat st;
+    if (fd == -1 || fstat(fd, &st) == -1 || (size_t)st.st_size < SAMPLELOG_DATA_OFFSET) {
+        perror(path);
+        return -1;
+    }
+    const struct SampleLogHeader *h = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (h == MAP_FAILED || memcmp(h->magic, SAMPLELOG_MAGIC, 8) != 0 || h->version != SAMPLELOG_VERSION) {
+        fprintf(stderr, "%s: not a version %d sample log\n", path, SAMPLELOG_VERSION);
+        return -1;
+    }
+    const struct SampleRecord *rec = (const void *)((const char *)h + SAMPLELOG_DATA_OFFSET);
+    uint64_t count = atomic_load(&((struct SampleLogHeader *)h)->count);
+    uint64_t fit = (st.st_size - SAMPLELOG_DATA_OFFSET) / sizeof(struct SampleRecord);
+    if (count > fit) count = fit;
+
+    printf("%-5s %5s %4s %13s %13s %9s  %s\n", "part", "tasks", "cpus", "measured_cpu", "predicted_cpu",
+           "mae_cpu", "per task measured/predicted (final %CPU)");
+    double total_err = 0;
+    int total_n = 0;
+    bool seen[128] = { false };
+    for (uint64_t i = 0; i < count; i++) {
+        char part = rec[i].part;
+        if (part <= 0 || seen[(int)part]) continue;
+        seen[(int)part] = true;
+        // spawn -s parts a-g pin their hogs or change their policy, which the
+        // model doesn't do: replaying them unpinned under SCHED_OTHER would
+        // report errors that say nothing about the model
+        if (part >= 'a' && part <= 'g') {
+            printf("%-5c skipped: affinity/policy part, not modeled\n", part);
+            continue;
+        }
+
+        // Gather the part's processes
+        struct Measured *m = calloc(MAX_TASKS, sizeof(struct Measured));
+        int nm = 0, no = 0;
+        uint64_t t0 = UINT64_MAX, t1 = UINT64_MAX;
+        for (uint64_t j = i; j < count; j++) {
+            const struct SampleRecord *r = &rec[j];
+            if (r->part != part || strncmp(r->comm, "t9_", 3) != 0) continue;
+            if (r->observation + 1 > no) no = r->observation + 1;
+            if (r->observation == 0 && t0 == UINT64_MAX) t0 = r->t_ns;
+            if (r->observation == 1 && t1 == UINT64_MAX) t1 = r->t_ns;
+            int k = 0;
+            while (k < nm && m[k].pid != r->pid) k++;
+            if (k == nm) {
+                if (nm == MAX_TASKS) continue;
+                m[nm++].pid = r->pid;
+            }
+            double lifetime = (h->base_boottime_ns + r->t_ns) / 1e9 - (double)r->starttime / h->clk_tck;
+            double cpu = lifetime > 0 ? (double)(r->utime + r->stime) / h->clk_tck / lifetime * 100 : 0;
+            m[k].nice = r->nice;
+            m[k].running += r->state == 'R';
+            m[k].observations++;
+            m[k].sum_cpu += cpu;
+            m[k].final_cpu = cpu;
+        }
+        if (nm == 0) {
+            // Only the driver or overseer was observed: nothing to replay
+            free(m);
+            continue;
+        }
+        qsort(m, nm, sizeof(struct Measured), compare_pid);
+
+        // Mostly sleeping at observations means blocked; hogs keep spawn's order
+        struct Config cfg = default_config(part, 0);
+        cfg.no = no;
+        cfg.io_ms = t1 != UINT64_MAX && t1 > t0 ? (t1 - t0 + 500000) / 1000000 : 500;
+        int *slot = malloc(nm * sizeof(int));
+        for (int k = 0; k < nm; k++) {
+            if (m[k].running * 2 < m[k].observations) continue;
+            if (m[k].nice != 0 && cfg.nnice < 64) {
+                cfg.nice[cfg.nnice].index = cfg.hogs;
+                cfg.nice[cfg.nnice++].nice = m[k].nice;
+            }
+            slot[k] = cfg.hogs++;
+        }
+        for (int k = 0; k < nm; k++) {
+            if (m[k].running * 2 < m[k].observations) slot[k] = cfg.hogs + cfg.blocked++;
+        }
+
+        int n = config_tasks(&cfg);
+        struct Sink sink = { .final_cpu = calloc(n, sizeof(double)) };
+        simulate(mode, ncpu, &cfg, &sink);
+
+        double meas = 0, pred = 0, err = 0;
+        for (int k = 0; k < nm; k++) {
+            meas += m[k].final_cpu;
+            pred += sink.final_cpu[slot[k]];
+            err += fabs(m[k].final_cpu - sink.final_cpu[slot[k]]);
+        }
+        printf("%-5c %5d %4d %13.1f %13.1f %9.2f ", part, nm, ncpu, meas / nm, pred / nm, err / nm);
+        for (int k = 0; k < nm && k < 8; k++) {
+            printf(" %.1f/%.1f%s", m[k].final_cpu, sink.final_cpu[slot[k]], m[k].nice ? "*" : "");
+        }
+        printf("%s\n", nm > 8 ? " ..." : "");
+        total_err += err;
+        total_n += nm;
+
+        free(sink.final_cpu);
+        free(slot);
+        free(m);
+    }
+    if (total_n) printf("mean absolute error %.2f %%CPU over %d processes (* = reniced)\n", total_err / total_n, total_n);
+    munmap((void *)h, st.st_size);
+    return 0;
+}
+
+// ---- throughput ----
+
+void bench(enum Mode mode, int count) {
+    srandom(42);
+    struct timespec a, b;
+    clock_gettime(CLOCK_MONOTONIC, &a);
+    uint64_t tasks = 0;
+    for (int i = 0; i < count; i++) {
+        int ncpu = 1 + random() % 8;
+        struct Config cfg = default_config('r', 1 + random() % (2 * ncpu));
+        cfg.blocked = random() % 2;
+        cfg.nnice = 1;
+        cfg.nice[0].index = random() % cfg.hogs;
+        cfg.nice[0].nice = (int)(random() % 40) - 20;
+        struct Sink sink = { 0 };
+        simulate(mode, ncpu, &cfg, &sink);
+        tasks += config_tasks(&cfg);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &b);
+    double wall = (b.tv_sec - a.tv_sec) + (b.tv_nsec - a.tv_nsec) / 1e9;
+    printf("%d configurations (%llu tasks, %.1f s simulated each) in %.3f s: %.0f configurations/s\n", count,
+           (unsigned long long)tasks, SETTLE_MS / 1e3 + 9 * 0.5, wall, count / wall);
+}
+
+int main(int argc, char *argv[]) {
+    cpu_set_t set;
+    int ncpu = sched_getaffinity(0, sizeof(set), &set) == 0 ? CPU_COUNT(&set) : 1;
+    enum Mode mode = EEVDF;
+    const char *out = "./log_sim";
+    const char *logdir = NULL;
+    int nbench = 0;
+
+    int a = 1;
+    for (; a < argc && argv[a][0] == '-'; a++) {
+        if (strcmp(argv[a], "-p") == 0 && a + 1 < argc) {
+            ncpu = atoi(argv[++a]);
+        } else if (strcmp(argv[a], "-m") == 0 && a + 1 < argc) {
+            mode = strcmp(argv[++a], "cfs") == 0 ? CFS : EEVDF;
+        } else if (strcmp(argv[a], "-o") == 0 && a + 1 < argc) {
+            out = argv[++a];
+        } else if (strcmp(argv[a], "-c") == 0) {
+            logdir = a + 1 < argc && argv[a + 1][0] != '-' ? argv[++a] : "./log";
+        } else if (strcmp(argv[a], "-b") == 0 && a + 1 < argc) {
+            nbench = atoi(argv[++a]);
+        } else {
+            fprintf(stderr, "usage: %s [-p CPUS] [-m eevdf|cfs] [-o DIR | -c [LOGDIR] | -b COUNT] [PART...]\n", argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+    if (ncpu < 1) ncpu = 1;
+
+    if (nbench > 0) {
+        bench(mode, nbench);
+        return 0;
+    }
+    if (logdir != NULL) return compare(mode, ncpu, logdir) == 0 ? 0 : EXIT_FAILURE;
+
+    struct Config *cfgs = malloc((argc + 4) * sizeof(struct Config));
+    int ncfg = 0;
+    if (a == argc) ncfg = tarefa6_parts(ncpu, cfgs);
+    for (; a < argc; a++) {
+        if (parse_config(argv[a], &cfgs[ncfg]) == -1) {
+            fprintf(stderr, "bad part description: %s\n", argv[a]);
+            return EXIT_FAILURE;
+        }
+        ncfg++;
+    }
+
+    uint64_t capacity = 0;
+    for (int k = 0; k < ncfg; k++) capacity += (uint64_t)cfgs[k].no * config_tasks(&cfgs[k]);
+    int fd;
+    struct SampleLogHeader *log = create_log(out, capacity, &fd);
+    if (log == NULL) return EXIT_FAILURE;
+
+    printf("%s on %d CPUs\n", mode == EEVDF ? "EEVDF" : "CFS", ncpu);
+    for (int k = 0; k < ncfg; k++) {
+        int n = config_tasks(&cfgs[k]);
+        struct Sink sink = { .log = log, .capacity = capacity, .final_cpu = calloc(n, sizeof(double)) };
+        simulate(mode, ncpu, &cfgs[k], &sink);
+        print_part(&cfgs[k], ncpu, &sink);
+        free(sink.final_cpu);
+    }
+
+    uint64_t used = atomic_load(&log->count);
+    munmap(log, SAMPLELOG_DATA_OFFSET + capacity * sizeof(struct SampleRecord));
+    close(fd);
+    fprintf(stderr, "%llu samples written to %s/samples.bin\n", (unsigned long long)used, out);
+    free(cfgs);
+    return 0;
+}
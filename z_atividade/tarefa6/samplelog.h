@@ -0,0 +1,65 @@
+// Binary sample log written by spawn's overseer and read by samples.
+//
+// One preallocated file per run: a fixed header, then capacity fixed-size
+// records. The file is mapped MAP_SHARED before the overseers fork, so
+// appending a sample is a fetch_add on count plus a store into the mapping.
+#ifndef SAMPLELOG_H
+#define SAMPLELOG_H
+
+#include <stdint.h>
+#include <stdatomic.h>
+
+#define SAMPLELOG_MAGIC "T9SAMPLE"
+#define SAMPLELOG_VERSION 3
+
+struct SampleLogHeader {
+    char magic[8];
+    uint32_t version;               // bumped whenever SampleRecord changes
+    uint32_t record_size;           // sizeof(struct SampleRecord) of the writer
+    uint64_t experiment_id;         // unique per run
+    uint64_t base_monotonic_ns;     // clock base: all three clocks read at creation,
+    uint64_t base_boottime_ns;      // record times are CLOCK_MONOTONIC minus
+    uint64_t base_realtime_ns;      // base_monotonic_ns
+    uint64_t clk_tck;               // unit of utime/stime/starttime
+    uint64_t capacity;              // records the file has room for
+    _Atomic uint64_t count;         // records claimed; may exceed capacity (dropped)
+    char workload[16];              // kernel the hogs ran, names the iterations unit
+    char pad[32];
+};
+
+// One process at one observation
+struct SampleRecord {
+    uint64_t t_ns;                  // when sampled, since base_monotonic_ns
+    uint64_t late_ns;               // observation's wakeup lateness vs its deadline
+    uint64_t run_ns;                // schedstat: time on CPU
+    uint64_t wait_ns;               // schedstat: time waiting on a run queue
+    uint64_t slices;                // schedstat: timeslices run
+    uint64_t starttime;             // clock ticks after boot
+    uint32_t utime, stime;          // clock ticks
+    uint32_t vcsw, nvcsw;           // voluntary/involuntary context switches
+    int32_t pid;
+    uint16_t observation;
+    int16_t cpu;                    // CPU it last ran on
+    char part;
+    char state;                     // R, S, D, Z, ...
+    int8_t nice;
+    int8_t priority;                // kernel priority (20 + nice for normal tasks)
+    int32_t threads;
+    char comm[16];
+    // perf_event counters since the overseer started watching the process;
+    // instructions/cycles stay 0 without hardware counters
+    uint64_t task_clock_ns;
+    uint64_t context_switches;
+    uint64_t cpu_migrations;
+    uint64_t instructions;
+    uint64_t cycles;
+    uint64_t iterations;            // work units the hog reported so far (see header workload)
+    double iter_rate;               // units/s since the previous observation
+};
+
+// Records start on their own cache line after the header
+#define SAMPLELOG_DATA_OFFSET 128
+
+_Static_assert(sizeof(struct SampleLogHeader) <= SAMPLELOG_DATA_OFFSET, "header overlaps records");
+
+#endif
@@ -0,0 +1,208 @@
+// Reader for the binary sample log spawn writes to ./log/samples.bin.
+//
+// Prints the records as CSV, or splits them into one raw little-endian array
+// per column (plus a schema.txt) so a plotting script can load just the
+// columns it needs with numpy.fromfile / polars without parsing text.
+//
+// Usage: ./samples [log/samples.bin]              CSV on stdout
+//        ./samples -c DIR [log/samples.bin]       columnar files in DIR
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "samplelog.h"
+
+struct SampleFile {
+    const struct SampleLogHeader *header;
+    const struct SampleRecord *records;
+    uint64_t count;
+    size_t bytes;
+};
+
+int open_samples(const char *path, struct SampleFile *f) {
+    int fd = open(path, O_RDONLY);
+    struct stat st;
+    if (fd == -1 || fstat(fd, &st) == -1) {
+        perror(path);
+        return -1;
+    }
+    if ((size_t)st.st_size < SAMPLELOG_DATA_OFFSET) {
+        fprintf(stderr, "%s: too short for a sample log\n", path);
+        return -1;
+    }
+
+    f->bytes = st.st_size;
+    void *map = mmap(NULL, f->bytes, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        perror("mmap");
+        return -1;
+    }
+
+    f->header = map;
+    if (memcmp(f->header->magic, SAMPLELOG_MAGIC, sizeof(f->header->magic)) != 0) {
+        fprintf(stderr, "%s: not a sample log\n", path);
+        return -1;
+    }
+    if (f->header->version != SAMPLELOG_VERSION || f->header->record_size != sizeof(struct SampleRecord)) {
+        fprintf(stderr, "%s: schema version %u (record %u bytes), this reader knows %d (%zu bytes)\n", path,
+                f->header->version, f->header->record_size, SAMPLELOG_VERSION, sizeof(struct SampleRecord));
+        return -1;
+    }
+
+    // A run that crashed never shrank the file: trust the smallest bound
+    f->records = (const struct SampleRecord *)((const char *)map + SAMPLELOG_DATA_OFFSET);
+    f->count = atomic_load(&((struct SampleLogHeader *)map)->count);
+    if (f->count > f->header->capacity) f->count = f->header->capacity;
+    uint64_t fit = (f->bytes - SAMPLELOG_DATA_OFFSET) / sizeof(struct SampleRecord);
+    if (f->count > fit) f->count = fit;
+    return 0;
+}
+
+// Previous run_ns/t_ns per pid, to turn cumulative counters into the share
+// of CPU since the last observation
+#define TRACK_SLOTS 65536
+
+struct Track {
+    int32_t pid;
+    uint64_t run_ns;
+    uint64_t t_ns;
+};
+
+double interval_util(struct Track *tracks, const struct SampleRecord *r) {
+    uint32_t h = (uint32_t)r->pid * 2654435761u;
+    for (uint32_t k = 0; k < TRACK_SLOTS; k++) {
+        struct Track *t = &tracks[(h + k) % TRACK_SLOTS];
+        if (t->pid != 0 && t->pid != r->pid) continue;
+
+        double util = -1;
+        if (t->pid == r->pid && r->t_ns > t->t_ns) {
+            util = (double)(r->run_ns - t->run_ns) / (r->t_ns - t->t_ns) * 100;
+        }
+        t->pid = r->pid;
+        t->run_ns = r->run_ns;
+        t->t_ns = r->t_ns;
+        return util;
+    }
+    return -1;
+}
+
+void print_csv(struct SampleFile *f) {
+    const struct SampleLogHeader *h = f->header;
+    struct Track *tracks = calloc(TRACK_SLOTS, sizeof(struct Track));
+
+    printf("experiment_id,part,observation,t_ms,late_us,pid,comm,state,pri,ni,cpu,threads,"
+           "utime,stime,pcpu,util,run_ms,wait_ms,slices,vcsw,nvcsw,"
+           "task_clock_ms,context_switches,cpu_migrations,instructions,cycles,iterations,iter_rate\n");
+    for (uint64_t i = 0; i < f->count; i++) {
+        const struct SampleRecord *r = &f->records[i];
+
+        // %CPU as ps computes it: CPU time over the process' lifetime
+        double now_s = (h->base_boottime_ns + r->t_ns) / 1e9;
+        double lifetime = now_s - (double)r->starttime / h->clk_tck;
+        double pcpu = lifetime > 0 ? (double)(r->utime + r->stime) / h->clk_tck / lifetime * 100 : 0;
+        double util = interval_util(tracks, r);
+
+        printf("%016llx,%c,%u,%.3f,%.1f,%d,%.16s,%c,%d,%d,%d,%d,%u,%u,%.1f,",
+               (unsigned long long)h->experiment_id, r->part, r->observation, r->t_ns / 1e6,
+               r->late_ns / 1e3, r->pid, r->comm, r->state, 39 - r->priority, r->nice, r->cpu,
+               r->threads, r->utime, r->stime, pcpu);
+        if (util >= 0) printf("%.1f", util);
+        printf(",%.3f,%.3f,%llu,%u,%u,%.3f,%llu,%llu,%llu,%llu,%llu,%.0f\n", r->run_ns / 1e6, r->wait_ns / 1e6,
+               (unsigned long long)r->slices, r->vcsw, r->nvcsw, r->task_clock_ns / 1e6,
+               (unsigned long long)r->context_switches, (unsigned long long)r->cpu_migrations,
+               (unsigned long long)r->instructions, (unsigned long long)r->cycles,
+               (unsigned long long)r->iterations, r->iter_rate);
+    }
+    free(tracks);
+}
+
+struct Column {
+    const char *name;
+    const char *type;
+    size_t offset;
+    size_t size;
+};
+
+#define COLUMN(field, type) { #field, type, offsetof(struct SampleRecord, field), sizeof(((struct SampleRecord *)0)->field) }
+
+const struct Column columns[] = {
+    COLUMN(t_ns, "u64"), COLUMN(late_ns, "u64"), COLUMN(run_ns, "u64"), COLUMN(wait_ns, "u64"),
+    COLUMN(slices, "u64"), COLUMN(starttime, "u64"), COLUMN(utime, "u32"), COLUMN(stime, "u32"),
+    COLUMN(vcsw, "u32"), COLUMN(nvcsw, "u32"), COLUMN(pid, "i32"), COLUMN(observation, "u16"),
+    COLUMN(cpu, "i16"), COLUMN(part, "u8"), COLUMN(state, "u8"), COLUMN(nice, "i8"),
+    COLUMN(priority, "i8"), COLUMN(threads, "i32"), COLUMN(comm, "S16"),
+    COLUMN(task_clock_ns, "u64"), COLUMN(context_switches, "u64"), COLUMN(cpu_migrations, "u64"),
+    COLUMN(instructions, "u64"), COLUMN(cycles, "u64"), COLUMN(iterations, "u64"), COLUMN(iter_rate, "f64"),
+};
+
+int write_columns(struct SampleFile *f, const char *dir) {
+    char path[4096];
+    mkdir(dir, 0755);
+
+    size_t ncolumns = sizeof(columns) / sizeof(columns[0]);
+    char *buf = malloc(f->count * sizeof(((struct SampleRecord *)0)->comm) + 1);
+
+    for (size_t c = 0; c < ncolumns; c++) {
+        const struct Column *col = &columns[c];
+        // Gather one field of every record into a contiguous array
+        for (uint64_t i = 0; i < f->count; i++) {
+            memcpy(buf + i * col->size, (const char *)&f->records[i] + col->offset, col->size);
+        }
+        snprintf(path, sizeof(path), "%s/%s.%s", dir, col->name, col->type);
+        FILE *out = fopen(path, "wb");
+        if (out == NULL || fwrite(buf, col->size, f->count, out) != f->count) {
+            perror(path);
+            free(buf);
+            return -1;
+        }
+        fclose(out);
+    }
+    free(buf);
+
+    snprintf(path, sizeof(path), "%s/schema.txt", dir);
+    FILE *schema = fopen(path, "w");
+    if (schema == NULL) {
+        perror(path);
+        return -1;
+    }
+    const struct SampleLogHeader *h = f->header;
+    fprintf(schema, "version %u\nexperiment_id %016llx\nworkload %.16s\nrows %llu\nclk_tck %llu\n"
+                    "base_monotonic_ns %llu\nbase_boottime_ns %llu\nbase_realtime_ns %llu\n",
+            h->version, (unsigned long long)h->experiment_id, h->workload, (unsigned long long)f->count,
+            (unsigned long long)h->clk_tck, (unsigned long long)h->base_monotonic_ns,
+            (unsigned long long)h->base_boottime_ns, (unsigned long long)h->base_realtime_ns);
+    for (size_t c = 0; c < ncolumns; c++) {
+        fprintf(schema, "column %s %s %s.%s\n", columns[c].name, columns[c].type, columns[c].name, columns[c].type);
+    }
+    fclose(schema);
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    const char *dir = NULL;
+    int a = 1;
+    if (argc > 2 && strcmp(argv[1], "-c") == 0) {
+        dir = argv[2];
+        a = 3;
+    }
+    const char *path = a < argc ? argv[a] : "./log/samples.bin";
+
+    struct SampleFile f;
+    if (open_samples(path, &f) == -1) return EXIT_FAILURE;
+
+    if (dir != NULL) {
+        if (write_columns(&f, dir) == -1) return EXIT_FAILURE;
+        fprintf(stderr, "%llu rows written to %s\n", (unsigned long long)f.count, dir);
+    } else {
+        print_csv(&f);
+    }
+    munmap((void *)f.header, f.bytes);
+    return 0;
+}
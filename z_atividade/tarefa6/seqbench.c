@@ -0,0 +1,123 @@
+// Benchmark for the seqlock in seqlock.h.
+//
+// One writer thread updates a ChildStats block as fast as it can, keeping
+// iterations, phase and stamp_ns equal, while reader threads copy it. Run
+// once with plain field stores and loads, once through the seqlock. A copy
+// whose fields disagree is torn. The seqlock should leave the writer's rate
+// where it was and bring torn copies to zero (readers pay in retries).
+//
+// Usage: ./seqbench [seconds per mode] [readers]
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "seqlock.h"
+
+struct Bench {
+    _Alignas(64) struct ChildStats stats;
+    _Alignas(64) atomic_bool stop;
+    bool locked;                    // seqlock or plain stores/loads
+    uint64_t writes;
+};
+
+struct Reader {
+    pthread_t thread;
+    struct Bench *bench;
+    uint64_t reads, torn, retries;
+};
+
+static double now_s(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+void *writer(void *arg) {
+    struct Bench *b = arg;
+    struct ChildStats *s = &b->stats;
+    uint64_t k = 0;
+
+    while (!atomic_load_explicit(&b->stop, memory_order_relaxed)) {
+        // Check the flag every 1024 updates, as monotono publishes in batches
+        for (int n = 0; n < 1024; n++) {
+            k++;
+            if (b->locked) {
+                stats_publish(s, k, (uint32_t)k, k);
+            } else {
+                atomic_store_explicit(&s->iterations, k, memory_order_relaxed);
+                atomic_store_explicit(&s->phase, (uint32_t)k, memory_order_relaxed);
+                atomic_store_explicit(&s->stamp_ns, k, memory_order_relaxed);
+            }
+        }
+    }
+    b->writes = k;
+    return NULL;
+}
+
+void *reader(void *arg) {
+    struct Reader *r = arg;
+    struct Bench *b = r->bench;
+    struct ChildSnapshot snap;
+
+    while (!atomic_load_explicit(&b->stop, memory_order_relaxed)) {
+        if (b->locked) {
+            r->retries += stats_snapshot(&b->stats, &snap);
+        } else {
+            snap.iterations = atomic_load_explicit(&b->stats.iterations, memory_order_relaxed);
+            snap.phase = atomic_load_explicit(&b->stats.phase, memory_order_relaxed);
+            snap.stamp_ns = atomic_load_explicit(&b->stats.stamp_ns, memory_order_relaxed);
+        }
+        if (snap.phase != (uint32_t)snap.iterations || snap.stamp_ns != snap.iterations) r->torn++;
+        r->reads++;
+    }
+    return NULL;
+}
+
+void run(bool locked, double seconds, int nreaders) {
+    struct Bench *b = aligned_alloc(64, sizeof(struct Bench));
+    *b = (struct Bench){ .locked = locked };
+    struct Reader *readers = calloc(nreaders, sizeof(struct Reader));
+
+    pthread_t w;
+    double start = now_s();
+    pthread_create(&w, NULL, writer, b);
+    for (int k = 0; k < nreaders; k++) {
+        readers[k].bench = b;
+        pthread_create(&readers[k].thread, NULL, reader, &readers[k]);
+    }
+
+    usleep(seconds * 1e6);
+    atomic_store(&b->stop, true);
+    pthread_join(w, NULL);
+    uint64_t reads = 0, torn = 0, retries = 0;
+    for (int k = 0; k < nreaders; k++) {
+        pthread_join(readers[k].thread, NULL);
+        reads += readers[k].reads;
+        torn += readers[k].torn;
+        retries += readers[k].retries;
+    }
+    double wall = now_s() - start;
+
+    printf("%-8s %14.0f %14.0f %12llu %12llu\n", locked ? "seqlock" : "plain", b->writes / wall, reads / wall,
+           (unsigned long long)torn, (unsigned long long)retries);
+    free(readers);
+    free(b);
+}
+
+int main(int argc, char *argv[]) {
+    double seconds = argc > 1 ? atof(argv[1]) : 2;
+    int nreaders = argc > 2 ? atoi(argv[2]) : 1;
+    if (nreaders < 1) nreaders = 1;
+
+    printf("%ld CPU(s), %d reader(s), %.1f s per mode\n", sysconf(_SC_NPROCESSORS_ONLN), nreaders, seconds);
+    printf("%-8s %14s %14s %12s %12s\n", "mode", "writes/s", "reads/s", "torn", "retries");
+    run(false, seconds, nreaders);
+    run(true, seconds, nreaders);
+    return 0;
+}
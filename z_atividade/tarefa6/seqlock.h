@@ -0,0 +1,79 @@
+// Seqlock for the per-child stats block spawn's children publish on the board.
+//
+// Each block has exactly one writer (the child) and any number of readers
+// (the overseer). The writer makes the sequence odd, updates the fields and
+// makes it even again; a reader that saw an odd sequence, or a different one
+// after copying the fields, copies them again. Writers never wait, and on
+// x86 the ordering costs nothing beyond the two sequence stores.
+//
+// The fields are relaxed atomics so the concurrent copy is not a data race;
+// the fences give the ordering.
+#ifndef SEQLOCK_H
+#define SEQLOCK_H
+
+#include <stdint.h>
+#include <stdatomic.h>
+#include <sched.h>
+
+static inline void seq_write_begin(_Atomic uint32_t *seq) {
+    uint32_t s = atomic_load_explicit(seq, memory_order_relaxed);
+    atomic_store_explicit(seq, s + 1, memory_order_relaxed);
+    // The odd sequence must be visible before any of the new fields
+    atomic_thread_fence(memory_order_release);
+}
+
+static inline void seq_write_end(_Atomic uint32_t *seq) {
+    uint32_t s = atomic_load_explicit(seq, memory_order_relaxed);
+    atomic_store_explicit(seq, s + 1, memory_order_release);
+}
+
+static inline uint32_t seq_read_begin(_Atomic uint32_t *seq) {
+    uint32_t s;
+    // A writer is mid-update; with one CPU it can't finish until we yield
+    while ((s = atomic_load_explicit(seq, memory_order_acquire)) & 1) sched_yield();
+    return s;
+}
+
+// True when the fields read since seq_read_begin may be torn
+static inline int seq_read_retry(_Atomic uint32_t *seq, uint32_t start) {
+    atomic_thread_fence(memory_order_acquire);
+    return atomic_load_explicit(seq, memory_order_relaxed) != start;
+}
+
+// What a child reports about itself
+struct ChildStats {
+    _Atomic uint32_t seq;
+    _Atomic uint32_t phase;         // outer rounds of the work loop completed
+    _Atomic uint64_t iterations;    // work loop iterations done so far
+    _Atomic uint64_t stamp_ns;      // CLOCK_MONOTONIC when iterations was current
+};
+
+struct ChildSnapshot {
+    uint32_t phase;
+    uint64_t iterations;
+    uint64_t stamp_ns;
+};
+
+static inline void stats_publish(struct ChildStats *s, uint64_t iterations, uint32_t phase, uint64_t stamp_ns) {
+    seq_write_begin(&s->seq);
+    atomic_store_explicit(&s->iterations, iterations, memory_order_relaxed);
+    atomic_store_explicit(&s->phase, phase, memory_order_relaxed);
+    atomic_store_explicit(&s->stamp_ns, stamp_ns, memory_order_relaxed);
+    seq_write_end(&s->seq);
+}
+
+// Consistent copy of the block; returns how many times it had to retry
+static inline int stats_snapshot(struct ChildStats *s, struct ChildSnapshot *out) {
+    int retries = -1;
+    uint32_t start;
+    do {
+        retries++;
+        start = seq_read_begin(&s->seq);
+        out->iterations = atomic_load_explicit(&s->iterations, memory_order_relaxed);
+        out->phase = atomic_load_explicit(&s->phase, memory_order_relaxed);
+        out->stamp_ns = atomic_load_explicit(&s->stamp_ns, memory_order_relaxed);
+    } while (seq_read_retry(&s->seq, start));
+    return retries;
+}
+
+#endif
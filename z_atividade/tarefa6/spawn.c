@@ -1,3 +1,4 @@
+#define _GNU_SOURCE
 #include <signal.h>
 #include <stdint.h>
 #include <sys/types.h>
@@ -9,42 +10,96 @@
 #include <time.h>
 #include <string.h>
 #include <sys/wait.h>
+#include <sys/resource.h>
+#include <sys/epoll.h>
+#include <sys/pidfd.h>
+#include <sys/timerfd.h>
+#include <sys/eventfd.h>
 #include <stdlib.h>
 #include <sys/prctl.h>
 #include <stdbool.h>
 #include <sys/mman.h>
 #include <sys/shm.h>
 #include <errno.h>
+#include <stdatomic.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#include <linux/futex.h>
+#include <limits.h>
+
+#include "samplelog.h"
+#include "seqlock.h"
+#include "workload.h"
+#include "arena.h"
 
 extern char **environ;
 extern char *program_invocation_short_name;
 
+struct PerfGroup;
+struct Latency;
+struct ArenaHeader;
+
+// Where a part pins its children
+enum Placement {
+    PLACE_ANY,          // wherever the scheduler puts them
+    PLACE_ONE_CORE,     // all on the first allowed CPU
+    PLACE_PER_CORE,     // one physical core each (first SMT thread), round robin
+    PLACE_SMT_SIBLINGS, // only the hardware threads of the first core
+};
+
 struct Experiment {
     size_t r; // repetitions
     char d; // description
     char desc[64];
-    uint8_t np; // number of processes
+    uint32_t np; // number of processes
     void (*task)(struct Experiment *);
-    uint8_t no; // number of observations
+    uint32_t no; // number of observations
     uint64_t io; // interval of observations
     pid_t pid; // experiment pid
     pid_t *child_pids; // array to store child process PIDs
     pid_t pidseer;
-    int shm_id;  // Shared memory id
-    void *shm_ptr; // Shared memory pointer
+    int shm_id;  // Shared memory id (memfd of the arena)
+    void *shm_ptr; // Shared memory pointer (the board, inside the arena)
+    struct ArenaHeader *arena; // shared arena the board and the children's results live in
+    int *child_pidfds; // pidfd per child, -1 once reaped
+    int nchild; // entries in child_pids/child_pidfds
+    pid_t pgid; // process group shared by all children
+    struct PerfGroup *child_perf; // counters per child, opened at fork
+    enum Placement placement; // CPUs each child is pinned to
+    int policy; // scheduling policy of the first half of the children
+    int probe_nice; // nice of the latency probe
+    bool probe_event; // probe waits for the driver's pokes instead of a timer
+    struct Latency *latency; // probe's histogram, shared with the driver
 } Experiment;
 
+// CPUs we may run on, as nproc counts them, without running nproc
 int nproc() {
-    FILE *fp;
-    char result[16];
     int cores = 1;
-    fp = popen("nproc", "r");
-    if (fgets(result, sizeof(result), fp) != NULL)
-        cores = atoi(result);
-    pclose(fp);
+    // The mask must cover every CPU the kernel knows; grow it until it does
+    for (int n = sysconf(_SC_NPROCESSORS_CONF) > 0 ? sysconf(_SC_NPROCESSORS_CONF) : 64;; n *= 2) {
+        cpu_set_t *set = CPU_ALLOC(n);
+        size_t size = CPU_ALLOC_SIZE(n);
+        int r = sched_getaffinity(0, size, set);
+        if (r == 0) cores = CPU_COUNT_S(size, set);
+        CPU_FREE(set);
+        if (r == 0 || errno != EINVAL) break;
+    }
     return cores;
 }
 
+// MemAvailable from /proc/meminfo in bytes, 0 if unknown
+size_t mem_available(void) {
+    FILE *f = fopen("/proc/meminfo", "r");
+    char line[128];
+    size_t kib = 0;
+    while (f && fgets(line, sizeof(line), f)) {
+        if (sscanf(line, "MemAvailable: %zu kB", &kib) == 1) break;
+    }
+    if (f) fclose(f);
+    return kib << 10;
+}
+
 void costume(char d[]) {
     char nome[32];
     snprintf(nome, 32, "t9_%s", d);
@@ -70,6 +125,29 @@ struct Seelog {
 } Seelog;
 
 #define LOG_DIR "./log"
+#define SETTLE_MS 500 // delay before the first observation
+
+// Run the overseer as SCHED_FIFO (-f) so observations aren't queued behind
+// the CPU hogs they are measuring
+bool seer_fifo = false;
+
+// Also write the old one-text-file-per-observation logs (-t), for analysis.py
+bool text_logs = false;
+
+// Kernel the CPU hogs run (-w), and how much memory each may map for it
+enum Workload workload = WORKLOAD_SCALAR;
+size_t workload_max_bytes = WORKLOAD_MAX_BYTES;
+
+// Also run the placement/policy parts (-s)
+bool sched_parts = false;
+
+// Also run the wakeup latency parts (-l)
+bool latency_parts = false;
+
+// Binary sample log for the whole run, shared with every overseer
+#define SAMPLELOG_PATH LOG_DIR "/samples.bin"
+struct SampleLogHeader *samplelog = NULL;
+int samplelog_fd = -1;
 
 struct Seelog init_seelog(int p, struct Experiment *seed) {
     struct Seelog seelog = { -1, "", seed };
@@ -101,77 +179,735 @@ struct Seelog init_seelog(int p, struct Experiment *seed) {
     return seelog;
 }
 
-void shell(int file_descriptor, char command[], char c[]) {
-    pid_t f = fork();
+// perf_event_open counter group for one process: task-clock leads, the
+// others follow so they are enabled and read together. Hardware events
+// (instructions, cycles) are optional; in VMs without a PMU the group is
+// just the software events.
+enum PerfEvent {
+    PERF_TASK_CLOCK,
+    PERF_CONTEXT_SWITCHES,
+    PERF_CPU_MIGRATIONS,
+    PERF_INSTRUCTIONS,
+    PERF_CYCLES,
+    PERF_NEVENTS,
+};
+
+struct PerfGroup {
+    int fd[PERF_NEVENTS];       // -1 for events this machine can't count
+    int nopen;
+};
+
+struct PerfCounts {
+    uint64_t value[PERF_NEVENTS];
+    bool valid[PERF_NEVENTS];
+};
+
+static int perf_open(pid_t pid, uint32_t type, uint64_t config, int group) {
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = type;
+    attr.config = config;
+    attr.read_format = PERF_FORMAT_GROUP;
+    attr.exclude_hv = 1;
+
+    int fd = syscall(SYS_perf_event_open, &attr, pid, -1, group, PERF_FLAG_FD_CLOEXEC);
+    if (fd == -1 && (errno == EACCES || errno == EPERM)) {
+        // perf_event_paranoid >= 2: unprivileged users may only count user space
+        attr.exclude_kernel = 1;
+        fd = syscall(SYS_perf_event_open, &attr, pid, -1, group, PERF_FLAG_FD_CLOEXEC);
+    }
+    return fd;
+}
 
-    if (f == 0) {
-        costume(c);
-        char *argv[] = {
-            "/usr/bin/sh",
-            "-c",
-            command,
-            NULL
-        };
+int perf_group_open(struct PerfGroup *g, pid_t pid) {
+    static const struct { uint32_t type; uint64_t config; } events[PERF_NEVENTS] = {
+        [PERF_TASK_CLOCK] = { PERF_TYPE_SOFTWARE, PERF_COUNT_SW_TASK_CLOCK },
+        [PERF_CONTEXT_SWITCHES] = { PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CONTEXT_SWITCHES },
+        [PERF_CPU_MIGRATIONS] = { PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CPU_MIGRATIONS },
+        [PERF_INSTRUCTIONS] = { PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+        [PERF_CYCLES] = { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+    };
+
+    g->nopen = 0;
+    for (int k = 0; k < PERF_NEVENTS; k++) {
+        int leader = k == 0 ? -1 : g->fd[0];
+        g->fd[k] = k == 0 || leader != -1 ? perf_open(pid, events[k].type, events[k].config, leader) : -1;
+        if (g->fd[k] != -1) g->nopen++;
+    }
+    return g->fd[0] == -1 ? -1 : 0;
+}
 
-        if (file_descriptor != STDOUT_FILENO)
-            if (dup2(file_descriptor, STDOUT_FILENO) == -1) {
-                perror("dup2");
-                exit(1);
-            }
+// Group read: the values come back in the order the members were opened
+int perf_group_read(struct PerfGroup *g, struct PerfCounts *c) {
+    uint64_t buf[1 + PERF_NEVENTS];
+    memset(c, 0, sizeof(*c));
+    if (g->fd[0] == -1 || read(g->fd[0], buf, sizeof(buf)) <= 0) return -1;
+
+    uint64_t i = 1;
+    for (int k = 0; k < PERF_NEVENTS && i <= buf[0]; k++) {
+        if (g->fd[k] == -1) continue;
+        c->value[k] = buf[i++];
+        c->valid[k] = true;
+    }
+    return 0;
+}
 
-        execve("/usr/bin/sh", argv, environ);
-        perror("execve");
-        exit(1);
-    } else if (f > 0) {
-        // Wait for the shell command to complete
-        int status;
-        waitpid(f, &status, 0);
-    } else {
-        perror("fork failed");
+void perf_group_close(struct PerfGroup *g) {
+    for (int k = 0; k < PERF_NEVENTS; k++) {
+        if (g->fd[k] != -1) close(g->fd[k]);
+        g->fd[k] = -1;
     }
+    g->nopen = 0;
 }
 
-void ps(struct Seelog pseer) {
-    // First show header
-    shell(pseer.file_descriptor, "ps -e -o pid,pri,ni,stat,%cpu,comm,cmd | head -n 1", "pseer_header");
-    // Show only our t9_* processes
-    shell(pseer.file_descriptor, "ps -e -o pid,pri,ni,stat,%cpu,comm,cmd | grep 't9_'", "pseer_filtered");
-    // Then show top t9_* processes by CPU usage
-    shell(pseer.file_descriptor, "echo '\n--- TOP t9_* CPU CONSUMERS ---'", "pseer_separator");
-    shell(pseer.file_descriptor, "ps -e -o pid,pri,ni,stat,%cpu,comm,cmd --sort=-%cpu | grep 't9_' | head -n 10", "pseer_top");
+// Parse a sysfs CPU list ("0-3,8,10-11") into set
+int read_cpulist(const char *path, cpu_set_t *set) {
+    char buf[1024];
+    CPU_ZERO(set);
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd == -1) return -1;
+    ssize_t n = read(fd, buf, sizeof(buf) - 1);
+    close(fd);
+    if (n <= 0) return -1;
+    buf[n] = '\0';
+
+    for (char *tok = strtok(buf, ",\n"); tok != NULL; tok = strtok(NULL, ",\n")) {
+        int lo, hi;
+        int k = sscanf(tok, "%d-%d", &lo, &hi);
+        if (k < 1) continue;
+        if (k == 1) hi = lo;
+        for (int c = lo; c <= hi && c < CPU_SETSIZE; c++) CPU_SET(c, set);
+    }
+    return 0;
 }
 
-void sensus(struct Seelog seelog) {
-    pid_t sensid = fork();
-    if (sensid == 0) {
-        costume("sensus");
-        // Give time for the main processes to start and establish themselves
-        usleep(500000);  // 500ms delay
-        ps(seelog);
-        exit(0);
-    } else if (sensid > 0) {
-        // Wait for the sensus process to complete
-        int status;
-        waitpid(sensid, &status, 0);
+// Hardware threads sharing cpu's core, falling back to cpu alone
+void smt_siblings(int cpu, cpu_set_t *set) {
+    char path[96];
+    snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/topology/thread_siblings_list", cpu);
+    if (read_cpulist(path, set) == -1 || !CPU_ISSET(cpu, set)) {
+        CPU_ZERO(set);
+        CPU_SET(cpu, set);
+    }
+}
+
+// The CPUs child p of a part may run on, within what we are allowed
+void placement_cpus(enum Placement placement, int p, cpu_set_t *set) {
+    cpu_set_t allowed, siblings;
+    sched_getaffinity(0, sizeof(allowed), &allowed);
+
+    int cpus[CPU_SETSIZE];
+    int n = 0;
+    for (int c = 0; c < CPU_SETSIZE; c++) {
+        if (!CPU_ISSET(c, &allowed)) continue;
+        if (placement == PLACE_PER_CORE) {
+            // Keep only the first allowed thread of each core
+            smt_siblings(c, &siblings);
+            CPU_AND(&siblings, &siblings, &allowed);
+            int first = 0;
+            while (!CPU_ISSET(first, &siblings)) first++;
+            if (first != c) continue;
+        }
+        cpus[n++] = c;
+    }
+
+    CPU_ZERO(set);
+    switch (placement) {
+        case PLACE_ANY:
+            *set = allowed;
+            break;
+        case PLACE_ONE_CORE:
+            CPU_SET(cpus[0], set);
+            break;
+        case PLACE_PER_CORE:
+            CPU_SET(cpus[p % n], set);
+            break;
+        case PLACE_SMT_SIBLINGS:
+            smt_siblings(cpus[0], &siblings);
+            CPU_AND(&siblings, &siblings, &allowed);
+            n = 0;
+            for (int c = 0; c < CPU_SETSIZE; c++) if (CPU_ISSET(c, &siblings)) cpus[n++] = c;
+            CPU_SET(cpus[p % n], set);
+            break;
+    }
+}
+
+const char *policy_name(int policy) {
+    switch (policy) {
+        case SCHED_OTHER: return "SCHED_OTHER";
+        case SCHED_BATCH: return "SCHED_BATCH";
+        case SCHED_IDLE: return "SCHED_IDLE";
+        case SCHED_FIFO: return "SCHED_FIFO";
+        case SCHED_RR: return "SCHED_RR";
+    }
+    return "?";
+}
+
+static bool rt_policy(int policy) {
+    return policy == SCHED_FIFO || policy == SCHED_RR;
+}
+
+// Runs in child p right after fork: pin it and, for the first half of the
+// children, switch to the part's policy. The other half stays SCHED_OTHER,
+// so each part shows how the policy fares against ordinary CPU hogs.
+// Real-time children get the lowest RT priority, below the overseer.
+void place(struct Experiment *e, int p) {
+    if (e->placement != PLACE_ANY) {
+        cpu_set_t set;
+        placement_cpus(e->placement, p, &set);
+        if (sched_setaffinity(0, sizeof(set), &set) == -1) perror("sched_setaffinity");
+    }
+
+    if (e->policy != SCHED_OTHER && p < (e->nchild + 1) / 2) {
+        struct sched_param sp = { .sched_priority = rt_policy(e->policy) ? sched_get_priority_min(e->policy) : 0 };
+        if (sched_setscheduler(0, e->policy, &sp) == -1) {
+            // Not permitted (no CAP_SYS_NICE / RLIMIT_RTPRIO): stay SCHED_OTHER
+            perror(policy_name(e->policy));
+        }
+    }
+}
+
+// One child's entry on the board, alone on its cache line so a child
+// updating its stats never invalidates a neighbour's
+struct Slot {
+    _Alignas(64) pid_t pid;
+    struct ChildStats stats; // written by the child under its seqlock
+    _Atomic arena_off history; // child's newest PhaseRecord in the arena
+};
+
+// Roster of the running part's children, shared with the overseer. The
+// overseer is forked before the children exist, so the driver publishes
+// each pid here and bumps count after the pid is in place. The children
+// inherit the mapping and report their progress in their slot, and wait
+// on go until every sibling has been forked.
+struct Board {
+    int capacity;
+    _Atomic int count;
+    _Atomic uint32_t go;
+    struct Slot slots[];
+};
+
+static long futex(_Atomic uint32_t *word, int op, uint32_t value) {
+    return syscall(SYS_futex, word, op, value, NULL, NULL, 0);
+}
+
+static size_t board_size(int capacity) {
+    return sizeof(struct Board) + capacity * sizeof(struct Slot);
+}
+
+// This process' slot and board when it is a tracked child, set right after fork
+struct Slot *my_slot = NULL;
+struct Board *my_board = NULL;
+
+// Don't compete with the driver (or spawners) still forking our siblings:
+// tracked children call this once ready, and supervise() starts them all
+void await_go(void) {
+    if (my_board == NULL) return;
+    while (atomic_load_explicit(&my_board->go, memory_order_acquire) == 0) {
+        futex(&my_board->go, FUTEX_WAIT, 0);
+    }
+}
+
+// A child's progress over the part, one record every HISTORY_INTERVAL_MS,
+// kept as a list in the arena (newest first) so the driver can read it
+// back after the child is gone
+#define HISTORY_INTERVAL_MS 50
+
+struct PhaseRecord {
+    arena_off prev; // older record, 0 for the first
+    uint64_t stamp_ns;
+    uint64_t iterations;
+    uint32_t phase;
+};
+
+// This process' allocation cache on the part's arena, reset right after fork
+struct ArenaCache my_cache;
+uint64_t my_history_ns = 0;
+
+// workload_run's on_step for tracked children
+void record_phase(uint64_t done, uint32_t phase, uint64_t now_ns) {
+    if (now_ns - my_history_ns < HISTORY_INTERVAL_MS * 1000000ull) return;
+    my_history_ns = now_ns;
+
+    // A full arena just ends the history early
+    arena_off off = arena_alloc(&my_cache, sizeof(struct PhaseRecord));
+    if (off == 0) return;
+    struct PhaseRecord *r = arena_ptr(my_cache.arena, off);
+    r->prev = atomic_load_explicit(&my_slot->history, memory_order_relaxed);
+    r->stamp_ns = now_ns;
+    r->iterations = done;
+    r->phase = phase;
+    atomic_store_explicit(&my_slot->history, off, memory_order_release);
+}
+
+// Cached /proc fds for one tracked process; each sample is three preads
+struct Probe {
+    pid_t pid;
+    int stat_fd;
+    int schedstat_fd;
+    int status_fd;
+    uint64_t last_run_ns; // schedstat run time at the previous sample
+    uint64_t last_at_ns;  // when the previous sample was taken
+    struct ChildSnapshot first; // slot stats at the first observation it had any
+    struct ChildSnapshot last; // slot stats at the previous observation
+    struct PerfGroup perf; // counting since the probe was opened
+};
+
+// One observation of one process
+struct Sample {
+    pid_t pid;
+    char comm[16];
+    char state;
+    int priority;       // kernel priority (20 + nice for normal tasks)
+    int nice;
+    pid_t pgrp, session, tpgid;
+    long threads;
+    unsigned long utime, stime;       // clock ticks
+    unsigned long long starttime;     // clock ticks after boot
+    int cpu;                          // CPU it last ran on
+    uint64_t run_ns, wait_ns, slices; // schedstat: on CPU, on run queue, timeslices
+    unsigned long vcsw, nvcsw;        // voluntary/involuntary context switches
+    struct PerfCounts perf;
+    struct ChildSnapshot progress;    // work reported through the board
+    double iter_rate;                 // work units/s since the previous observation
+};
+
+static uint64_t clock_ns(clockid_t clock) {
+    struct timespec ts;
+    clock_gettime(clock, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+int probe_open(struct Probe *probe, pid_t pid) {
+    char path[64];
+    probe->pid = pid;
+    snprintf(path, sizeof(path), "/proc/%d/stat", pid);
+    probe->stat_fd = open(path, O_RDONLY | O_CLOEXEC);
+    snprintf(path, sizeof(path), "/proc/%d/schedstat", pid);
+    probe->schedstat_fd = open(path, O_RDONLY | O_CLOEXEC);
+    snprintf(path, sizeof(path), "/proc/%d/status", pid);
+    probe->status_fd = open(path, O_RDONLY | O_CLOEXEC);
+    probe->last_run_ns = 0;
+    probe->last_at_ns = 0;
+    probe->first = (struct ChildSnapshot){ 0 };
+    probe->last = (struct ChildSnapshot){ 0 };
+    perf_group_open(&probe->perf, pid);
+    return probe->stat_fd == -1 ? -1 : 0;
+}
+
+void probe_close(struct Probe *probe) {
+    if (probe->stat_fd != -1) close(probe->stat_fd);
+    if (probe->schedstat_fd != -1) close(probe->schedstat_fd);
+    if (probe->status_fd != -1) close(probe->status_fd);
+    probe->stat_fd = probe->schedstat_fd = probe->status_fd = -1;
+    perf_group_close(&probe->perf);
+}
+
+static ssize_t pread_text(int fd, char *buf, size_t size) {
+    if (fd == -1) return -1;
+    ssize_t n = pread(fd, buf, size - 1, 0);
+    if (n >= 0) buf[n] = '\0';
+    return n;
+}
+
+// Fails (ESRCH) once the process has been reaped
+int probe_read(struct Probe *probe, struct Sample *s) {
+    char buf[2048];
+    memset(s, 0, sizeof(*s));
+    s->pid = probe->pid;
+
+    if (pread_text(probe->stat_fd, buf, sizeof(buf)) <= 0) return -1;
+    // comm may hold spaces or parentheses; the fields resume after the last ')'
+    char *open_paren = strchr(buf, '(');
+    char *close_paren = strrchr(buf, ')');
+    if (open_paren == NULL || close_paren == NULL) return -1;
+    size_t len = close_paren - open_paren - 1;
+    if (len >= sizeof(s->comm)) len = sizeof(s->comm) - 1;
+    memcpy(s->comm, open_paren + 1, len);
+    sscanf(close_paren + 2,
+           "%c %*d %d %d %*d %d %*u %*u %*u %*u %*u %lu %lu %*d %*d %d %d %ld %*d %llu"
+           " %*u %*d %*u %*u %*u %*u %*u %*u %*u %*u %*u %*u %*u %*u %*u %*d %d",
+           &s->state, &s->pgrp, &s->session, &s->tpgid, &s->utime, &s->stime,
+           &s->priority, &s->nice, &s->threads, &s->starttime, &s->cpu);
+
+    if (pread_text(probe->schedstat_fd, buf, sizeof(buf)) > 0) {
+        sscanf(buf, "%lu %lu %lu", &s->run_ns, &s->wait_ns, &s->slices);
+    }
+
+    if (pread_text(probe->status_fd, buf, sizeof(buf)) > 0) {
+        char *v = strstr(buf, "\nvoluntary_ctxt_switches:");
+        if (v) s->vcsw = strtoul(v + 25, NULL, 10);
+        v = strstr(buf, "\nnonvoluntary_ctxt_switches:");
+        if (v) s->nvcsw = strtoul(v + 28, NULL, 10);
+    }
+
+    perf_group_read(&probe->perf, &s->perf);
+    return 0;
+}
+
+// Write the sample as a ps -o pid,pri,ni,stat,%cpu,comm row (so analysis.py
+// reads it unchanged) followed by the scheduler fields ps can't show
+void probe_log(struct Probe *probe, struct Sample *s, int fd) {
+    static long hz = 0;
+    if (hz == 0) hz = sysconf(_SC_CLK_TCK);
+
+    // Same STAT letters ps prints
+    char stat[8];
+    int k = 0;
+    stat[k++] = s->state;
+    if (s->nice < 0) stat[k++] = '<';
+    if (s->nice > 0) stat[k++] = 'N';
+    if (s->session == s->pid) stat[k++] = 's';
+    if (s->threads > 1) stat[k++] = 'l';
+    if (s->tpgid == s->pgrp) stat[k++] = '+';
+    stat[k] = '\0';
+
+    // %CPU as ps computes it: CPU time over lifetime
+    uint64_t now = clock_ns(CLOCK_BOOTTIME);
+    double lifetime = now / 1e9 - (double)s->starttime / hz;
+    double pcpu = lifetime > 0 ? (double)(s->utime + s->stime) / hz / lifetime * 100 : 0;
+
+    // Share of the CPU since the previous sample, from schedstat
+    uint64_t at = clock_ns(CLOCK_MONOTONIC);
+    double util = probe->last_at_ns ? (double)(s->run_ns - probe->last_run_ns) / (at - probe->last_at_ns) * 100 : 0;
+    probe->last_run_ns = s->run_ns;
+    probe->last_at_ns = at;
+
+    char line[256];
+    int n = snprintf(line, sizeof(line),
+                     "%5d %3d %3d %-4s %4.1f %-15s cpu=%d util=%.1f run_ms=%.3f wait_ms=%.3f slices=%lu vcsw=%lu nvcsw=%lu"
+                     " work=%llu phase=%u work_rate=%.0f\n",
+                     s->pid, 39 - s->priority, s->nice, stat, pcpu, s->comm, s->cpu, util,
+                     s->run_ns / 1e6, s->wait_ns / 1e6, s->slices, s->vcsw, s->nvcsw,
+                     (unsigned long long)s->progress.iterations, s->progress.phase, s->iter_rate);
+    if (write(fd, line, n) != n) perror("write log");
+}
+
+// Preallocate and map the run's sample log; the mapping is inherited by
+// the overseers, which then append without any syscall
+int samplelog_create(const char *path, uint64_t capacity) {
+    size_t bytes = SAMPLELOG_DATA_OFFSET + capacity * sizeof(struct SampleRecord);
+    samplelog_fd = open(path, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (samplelog_fd == -1 || ftruncate(samplelog_fd, bytes) == -1) {
+        perror("sample log");
+        return -1;
+    }
+    samplelog = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, samplelog_fd, 0);
+    if (samplelog == MAP_FAILED) {
+        perror("mmap sample log");
+        samplelog = NULL;
+        return -1;
+    }
+
+    memcpy(samplelog->magic, SAMPLELOG_MAGIC, sizeof(samplelog->magic));
+    samplelog->version = SAMPLELOG_VERSION;
+    samplelog->record_size = sizeof(struct SampleRecord);
+    samplelog->base_monotonic_ns = clock_ns(CLOCK_MONOTONIC);
+    samplelog->base_boottime_ns = clock_ns(CLOCK_BOOTTIME);
+    samplelog->base_realtime_ns = clock_ns(CLOCK_REALTIME);
+    samplelog->experiment_id = samplelog->base_realtime_ns ^ ((uint64_t)getpid() << 48);
+    samplelog->clk_tck = sysconf(_SC_CLK_TCK);
+    samplelog->capacity = capacity;
+    atomic_store(&samplelog->count, 0);
+    return 0;
+}
+
+struct SampleRecord *samplelog_claim() {
+    if (samplelog == NULL) return NULL;
+    uint64_t i = atomic_fetch_add_explicit(&samplelog->count, 1, memory_order_relaxed);
+    if (i >= samplelog->capacity) return NULL;
+    return (struct SampleRecord *)((char *)samplelog + SAMPLELOG_DATA_OFFSET) + i;
+}
+
+// Shrink the file to the records actually written
+void samplelog_close() {
+    if (samplelog == NULL) return;
+    uint64_t used = atomic_load(&samplelog->count);
+    if (used > samplelog->capacity) {
+        fprintf(stderr, "sample log full: %llu samples dropped\n",
+                (unsigned long long)(used - samplelog->capacity));
+        used = samplelog->capacity;
+    }
+    size_t bytes = SAMPLELOG_DATA_OFFSET + samplelog->capacity * sizeof(struct SampleRecord);
+    samplelog->capacity = used;
+    atomic_store(&samplelog->count, used);
+    munmap(samplelog, bytes);
+    if (ftruncate(samplelog_fd, SAMPLELOG_DATA_OFFSET + used * sizeof(struct SampleRecord)) == -1) {
+        perror("ftruncate sample log");
+    }
+    close(samplelog_fd);
+    samplelog = NULL;
+}
+
+// One observation: open probes for pids published since the last one, then
+// sample everything still alive into the binary log (and the text log, if
+// one is open). No fork, no exec, a few preads per process. stamp carries
+// the observation-wide fields.
+void sensus(struct Seelog seelog, struct Board *board, struct Probe *probes, int *nprobes,
+            const struct SampleRecord *stamp) {
+    int count = atomic_load_explicit(&board->count, memory_order_acquire);
+    for (; *nprobes < count; (*nprobes)++) {
+        probe_open(&probes[*nprobes], board->slots[*nprobes].pid);
+    }
+
+    if (seelog.file_descriptor != -1) {
+        const char header[] = "  PID PRI  NI STAT %CPU COMMAND         SCHED\n";
+        if (write(seelog.file_descriptor, header, sizeof(header) - 1) < 0) perror("write log");
+    }
+
+    for (int p = 0; p < *nprobes; p++) {
+        struct Sample sample;
+        if (probes[p].stat_fd == -1) continue;
+        if (probe_read(&probes[p], &sample) == -1) {
+            probe_close(&probes[p]);
+            continue;
+        }
+
+        // Throughput between the child's own timestamps, so the overseer's
+        // wakeup lateness doesn't skew it; probes and slots share indices
+        struct ChildSnapshot *last = &probes[p].last;
+        stats_snapshot(&board->slots[p].stats, &sample.progress);
+        if (last->stamp_ns != 0 && sample.progress.stamp_ns > last->stamp_ns) {
+            sample.iter_rate = (double)(sample.progress.iterations - last->iterations) * 1e9 /
+                               (sample.progress.stamp_ns - last->stamp_ns);
+        }
+        if (sample.progress.stamp_ns != 0) *last = sample.progress;
+        if (probes[p].first.stamp_ns == 0) probes[p].first = *last;
+
+        struct SampleRecord *rec = samplelog_claim();
+        if (rec != NULL) {
+            *rec = *stamp;
+            rec->run_ns = sample.run_ns;
+            rec->wait_ns = sample.wait_ns;
+            rec->slices = sample.slices;
+            rec->starttime = sample.starttime;
+            rec->utime = sample.utime;
+            rec->stime = sample.stime;
+            rec->vcsw = sample.vcsw;
+            rec->nvcsw = sample.nvcsw;
+            rec->pid = sample.pid;
+            rec->cpu = sample.cpu;
+            rec->state = sample.state;
+            rec->nice = sample.nice;
+            rec->priority = sample.priority;
+            rec->threads = sample.threads;
+            memcpy(rec->comm, sample.comm, sizeof(rec->comm));
+            rec->task_clock_ns = sample.perf.value[PERF_TASK_CLOCK];
+            rec->context_switches = sample.perf.value[PERF_CONTEXT_SWITCHES];
+            rec->cpu_migrations = sample.perf.value[PERF_CPU_MIGRATIONS];
+            // Zero when the machine has no hardware counters
+            rec->instructions = sample.perf.value[PERF_INSTRUCTIONS];
+            rec->cycles = sample.perf.value[PERF_CYCLES];
+            rec->iterations = sample.progress.iterations;
+            rec->iter_rate = sample.iter_rate;
+        }
+
+        if (seelog.file_descriptor != -1) probe_log(&probes[p], &sample, seelog.file_descriptor);
+    }
+}
+
+// Shared roster for up to capacity children, mapped before the overseer
+// forks. It is the root of a memfd arena (seed->shm_id) with a bump chunk's
+// worth of room per child for what the children record.
+struct Board *board_create(struct Experiment *seed, int capacity) {
+    size_t bytes = 4096 + 2 * board_size(capacity) + (size_t)(capacity + 1) * ARENA_CHUNK;
+    seed->arena = arena_create("t9_board", bytes, &seed->shm_id);
+    if (seed->arena == NULL) return NULL;
+
+    // Slots want whole cache lines; arena payloads are only 8-byte aligned
+    struct ArenaCache cache;
+    arena_cache_init(&cache, seed->arena);
+    char *raw = arena_ptr(seed->arena, arena_alloc(&cache, board_size(capacity) + 64));
+    struct Board *board = (struct Board *)(((uintptr_t)raw + 63) & ~(uintptr_t)63);
+    memset(board, 0, board_size(capacity));
+    board->capacity = capacity;
+    atomic_store(&board->count, 0);
+    atomic_store(&board->go, 0);
+    atomic_store(&seed->arena->root, arena_off_of(seed->arena, board));
+    return board;
+}
+
+// Write each child's phase history to log/<d>.history and say how much
+// of the arena it took; every child is dead by now
+void history_report(struct Experiment *e) {
+    struct Board *board = e->shm_ptr;
+    int n = atomic_load(&board->count);
+    if (n > board->capacity) n = board->capacity;
+
+    char path[64];
+    snprintf(path, sizeof(path), "%s/%c.history", LOG_DIR, e->d);
+    FILE *out = fopen(path, "w");
+    if (out == NULL) {
+        perror(path);
         return;
     }
-    return;
+    fprintf(out, "slot,pid,t_ms,phase,%s\n", workload_units[workload]);
+
+    uint64_t records = 0, children = 0;
+    uint64_t start = UINT64_MAX;
+    for (int p = 0; p < n; p++) {
+        arena_off off = atomic_load_explicit(&board->slots[p].history, memory_order_acquire);
+        if (off == 0) continue;
+        // The list is newest first; the oldest record sets the part's clock
+        for (arena_off o = off; o != 0;) {
+            struct PhaseRecord *r = arena_ptr(e->arena, o);
+            if (r->stamp_ns < start) start = r->stamp_ns;
+            o = r->prev;
+        }
+    }
+    for (int p = 0; p < n; p++) {
+        arena_off off = atomic_load_explicit(&board->slots[p].history, memory_order_acquire);
+        if (off == 0) continue;
+        children++;
+        for (arena_off o = off; o != 0;) {
+            struct PhaseRecord *r = arena_ptr(e->arena, o);
+            fprintf(out, "%d,%d,%.3f,%u,%llu\n", p, board->slots[p].pid, (r->stamp_ns - start) / 1e6, r->phase,
+                    (unsigned long long)r->iterations);
+            records++;
+            o = r->prev;
+        }
+    }
+    fclose(out);
+    if (children > 0) {
+        printf("Phase history: %llu records from %llu children in %s (arena: %.1f of %.1f MiB reserved)\n",
+               (unsigned long long)records, (unsigned long long)children, path,
+               atomic_load(&e->arena->top) / 1048576.0, e->arena->size / 1048576.0);
+    }
+}
+
+static int compare_u64(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+// Percentile of a sorted array, in microseconds
+static double pct_us(uint64_t *v, int n, int p) {
+    int i = n * p / 100;
+    return v[i < n ? i : n - 1] / 1e3;
+}
+
+// Wakeup lateness against each deadline, and how far each period between
+// observations strayed from io; printed and saved next to the part's logs
+void jitter_report(struct Experiment *seed, uint64_t *late, uint64_t *woke, int n) {
+    if (n == 0) return;
+    uint64_t period = seed->io * 1000000ull;
+
+    uint64_t *dev = malloc(n * sizeof(uint64_t));
+    int nd = 0;
+    for (int p = 1; p < n; p++) {
+        uint64_t gap = woke[p] - woke[p - 1];
+        dev[nd++] = gap > period ? gap - period : period - gap;
+    }
+    qsort(late, n, sizeof(uint64_t), compare_u64);
+    qsort(dev, nd, sizeof(uint64_t), compare_u64);
+
+    char line[256];
+    int len = snprintf(line, sizeof(line),
+                       "part %c: %d observations every %llu ms%s\n"
+                       "late_us p50 %.1f p90 %.1f p99 %.1f max %.1f\n"
+                       "period_jitter_us p50 %.1f p90 %.1f p99 %.1f max %.1f\n",
+                       seed->d, n, (unsigned long long)seed->io, seer_fifo || rt_policy(seed->policy) ? " (SCHED_FIFO)" : "",
+                       pct_us(late, n, 50), pct_us(late, n, 90), pct_us(late, n, 99), pct_us(late, n, 100),
+                       nd ? pct_us(dev, nd, 50) : 0, nd ? pct_us(dev, nd, 90) : 0,
+                       nd ? pct_us(dev, nd, 99) : 0, nd ? pct_us(dev, nd, 100) : 0);
+    printf("%s", line);
+
+    char path[64];
+    snprintf(path, sizeof(path), "%s/%c.jitter", LOG_DIR, seed->d);
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd != -1) {
+        if (write(fd, line, len) != len) perror("write jitter");
+        close(fd);
+    }
+    free(dev);
 }
 
 void pseer(struct Experiment *seed) {
-    if (seed->no <= 0) return;
+    if (seed->no == 0) return;
 
+    // Room for the largest part (N+1 children)
+    seed->shm_ptr = board_create(seed, seed->np + 1);
+    if (seed->shm_ptr == NULL) return;
+
+    fflush(stdout);
     pid_t pidseer = fork();
 
     if (pidseer == 0) {
         costume("overseing");
-        for (int p = 0; p < seed->no; p++) {
-            struct Seelog seelog = init_seelog(p, seed);
-            sensus(seelog);
-            if (seelog.file_descriptor != -1) {
-                close(seelog.file_descriptor);
+
+        // Above real-time children too, or it would never get to observe them
+        if (seer_fifo || rt_policy(seed->policy)) {
+            struct sched_param sp = { .sched_priority = sched_get_priority_min(SCHED_FIFO) + 1 };
+            if (sched_setscheduler(0, SCHED_FIFO, &sp) == -1) perror("sched_setscheduler(SCHED_FIFO)");
+        }
+
+        // Absolute deadlines: observation p is due at start + SETTLE_MS + p*io,
+        // however long the previous ones took, so the period can't drift
+        uint64_t period = seed->io * 1000000ull;
+        uint64_t first = clock_ns(CLOCK_MONOTONIC) + SETTLE_MS * 1000000ull;
+        int tfd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
+        struct itimerspec its = {
+            .it_interval = { period / 1000000000ull, period % 1000000000ull },
+            .it_value = { first / 1000000000ull, first % 1000000000ull },
+        };
+        if (tfd == -1 || timerfd_settime(tfd, TFD_TIMER_ABSTIME, &its, NULL) == -1) {
+            perror("timerfd");
+            exit(1);
+        }
+
+        struct Board *board = seed->shm_ptr;
+        struct Probe *probes = malloc(board->capacity * sizeof(struct Probe));
+        int nprobes = 0;
+        uint64_t *late = malloc(seed->no * sizeof(uint64_t));
+        uint64_t *woke = malloc(seed->no * sizeof(uint64_t));
+        uint64_t ticks = 0;
+        int taken = 0;
+
+        for (uint32_t p = 0; p < seed->no; p++) {
+            uint64_t expirations;
+            if (read(tfd, &expirations, sizeof(expirations)) != sizeof(expirations)) break;
+            uint64_t now = clock_ns(CLOCK_MONOTONIC);
+            ticks += expirations;
+            if (expirations > 1) {
+                printf("Observation %u is %llu period(s) late\n", p, (unsigned long long)expirations - 1);
             }
-            usleep(seed->io * 1000); // Convert to microseconds
+
+            // The deadline this wakeup answers is the latest one that expired
+            uint64_t intended = first + (ticks - 1) * period;
+            late[taken] = now - intended;
+            woke[taken] = now;
+            taken++;
+
+            struct SampleRecord stamp = {
+                .t_ns = samplelog ? now - samplelog->base_monotonic_ns : now,
+                .late_ns = now - intended,
+                .observation = p,
+                .part = seed->d,
+            };
+            struct Seelog seelog = { -1, "", seed };
+            if (text_logs) {
+                seelog = init_seelog(p, seed);
+                if (seelog.file_descriptor != -1) {
+                    dprintf(seelog.file_descriptor, "# intended_ns=%llu actual_ns=%llu late_us=%.1f\n",
+                            (unsigned long long)intended, (unsigned long long)now, (now - intended) / 1e3);
+                }
+            }
+            sensus(seelog, board, probes, &nprobes, &stamp);
+            if (seelog.file_descriptor != -1) close(seelog.file_descriptor);
+        }
+        jitter_report(seed, late, woke, taken);
+
+        // Work each child got, comparable across parts. The rate only counts
+        // work between its first and last observation: children start before
+        // the settle delay, and their work from then has no matching time span
+        for (int p = 0; p < nprobes; p++) {
+            struct ChildSnapshot *start = &probes[p].first, *last = &probes[p].last;
+            if (start->stamp_ns == 0 || last->stamp_ns <= start->stamp_ns) continue;
+            printf("part %c PID %d: %llu %s, %.0f %s/s\n", seed->d, probes[p].pid,
+                   (unsigned long long)last->iterations, workload_units[workload],
+                   (last->iterations - start->iterations) * 1e9 / (last->stamp_ns - start->stamp_ns),
+                   workload_units[workload]);
         }
         exit(0);
     } else {
@@ -201,184 +937,538 @@ void monotono(struct Experiment *e) {
         printf("CPU process running as: %s (PID: %d)\n", current_name, getpid());
     }
 
-    // Infinite CPU-intensive loop
-    while (1) {
-        // More intensive CPU work to ensure high CPU usage
-        volatile double result = 0.0;
-        for (volatile int i = 0; i < 10000000; i++) {
-            result += i * i / (i + 1.0);
-        }
-    }
+    // Buffers and step size are ready before the part starts, so no hog's
+    // page faults or calibration land in the others' measured time
+    struct WorkloadState work;
+    if (workload_setup(&work, workload, workload_max_bytes) == -1) exit(1);
+    uint64_t reps = workload_calibrate(&work);
+    await_go();
+
+    // Infinite CPU-intensive loop, publishing progress after every step (a
+    // seqlock write to our own cache line, no syscall) and keeping a history
+    workload_run(&work, reps, my_slot != NULL ? &my_slot->stats : NULL,
+                 my_slot != NULL && my_cache.arena != NULL ? record_phase : NULL);
     exit(0); // Never reached
 }
 
-void parte_1(struct Experiment *e) {
-    // Allocate array to store child PIDs
-    e->child_pids = malloc(e->np * sizeof(pid_t));
-    if (e->child_pids == NULL) {
-        perror("Failed to allocate memory for child PIDs");
-        return;
+// Wakeup latency histogram, written by the probe and read by the driver
+// once the probe is dead
+#define LATENCY_INTERVAL_US 1000
+#define LATENCY_BUCKETS 10000 // 1 us each; anything slower counts as overflow
+
+struct Latency {
+    uint64_t interval_ns;
+    int eventfd;              // the driver's pokes, when probe_event
+    _Atomic uint64_t poke_ns; // oldest poke the probe hasn't read, 0 if none
+    uint64_t samples;
+    uint64_t overflow;
+    uint64_t missed;          // periods or pokes skipped because we woke too late
+    uint64_t max_ns;
+    uint64_t sum_ns;
+    uint32_t hist[LATENCY_BUCKETS];
+};
+
+struct Latency *latency_create(bool event) {
+    struct Latency *l = mmap(NULL, sizeof(struct Latency), PROT_READ | PROT_WRITE,
+                             MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (l == MAP_FAILED) {
+        perror("mmap latency");
+        return NULL;
     }
+    l->interval_ns = LATENCY_INTERVAL_US * 1000ull;
+    l->eventfd = -1;
+    if (event) {
+        l->eventfd = eventfd(0, EFD_CLOEXEC);
+        if (l->eventfd == -1) perror("eventfd");
+    }
+    return l;
+}
 
-    // Launch N CPU-intensive processes
-    for (int p = 0; p < e->np; p++) {
-        pid_t subid = fork();
-
-        if (subid == 0) {
-            char nome[32];
-            snprintf(nome, 32, "%c_%d", e->d, p);
-            costume(nome);
-            monotono(NULL); // This will never return
-            exit(0);
-        } else {
-            e->child_pids[p] = subid;
-            printf("Started process %d with PID %d\n", p, subid);
+static void latency_add(struct Latency *l, uint64_t ns) {
+    l->samples++;
+    l->sum_ns += ns;
+    if (ns > l->max_ns) l->max_ns = ns;
+    if (ns / 1000 < LATENCY_BUCKETS) {
+        l->hist[ns / 1000]++;
+    } else {
+        l->overflow++;
+    }
+}
+
+// cyclictest-style probe: sleep until an absolute deadline (or until the
+// driver pokes the eventfd) and record how late we got the CPU back
+void latency_probe(struct Experiment *e) {
+    struct Latency *l = e->latency;
+    if (setpriority(PRIO_PROCESS, 0, e->probe_nice) == -1) perror("setpriority");
+    // Page faults on the histogram would show up as latency
+    if (mlockall(MCL_CURRENT | MCL_FUTURE) == -1) perror("mlockall");
+    // The default 50 us timer slack would be measured as latency
+    prctl(PR_SET_TIMERSLACK, 1, 0, 0, 0);
+
+    if (l->eventfd != -1) {
+        uint64_t pokes;
+        while (read(l->eventfd, &pokes, sizeof(pokes)) == sizeof(pokes)) {
+            uint64_t now = clock_ns(CLOCK_MONOTONIC);
+            // Pokes coalesce in the counter; only the first one was stamped,
+            // and one that came in after it, before the stamp was taken back,
+            // has none and shows up here alone
+            uint64_t poke = atomic_exchange_explicit(&l->poke_ns, 0, memory_order_acquire);
+            if (poke != 0) {
+                latency_add(l, now - poke);
+                pokes--;
+            }
+            l->missed += pokes;
         }
+        exit(1);
     }
 
-    // Wait for the observer process to finish
-    int status;
-    waitpid(e->pidseer, &status, 0);
+    uint64_t next = clock_ns(CLOCK_MONOTONIC) + l->interval_ns;
+    while (1) {
+        struct timespec ts = { next / 1000000000ull, next % 1000000000ull };
+        while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR);
+        uint64_t now = clock_ns(CLOCK_MONOTONIC);
+        latency_add(l, now - next);
+
+        next += l->interval_ns;
+        // Don't queue up deadlines we already slept through
+        while (next <= now) {
+            next += l->interval_ns;
+            l->missed++;
+        }
+    }
+}
 
-    printf("Observer process exited, cleaning up experiment processes\n");
-    fflush(stdout);
+// Latency percentile from the histogram, in microseconds
+static uint64_t latency_pct(struct Latency *l, int p) {
+    uint64_t want = (l->samples * p + 99) / 100, seen = 0;
+    for (int b = 0; b < LATENCY_BUCKETS; b++) {
+        seen += l->hist[b];
+        if (seen >= want && want > 0) return b;
+    }
+    return l->max_ns / 1000;
+}
 
-    // Give some time for the ps command to finish observing
-    sleep(1);
+// Print p50/p99/max and save them with the histogram as log/<d>.latency
+void latency_report(struct Experiment *e) {
+    struct Latency *l = e->latency;
+    if (l == NULL || l->samples == 0) return;
+
+    char line[256];
+    snprintf(line, sizeof(line),
+             "part %c: latency probe nice %d (%s, %llu us) under %d hogs\n"
+             "latency_us samples %llu p50 %llu p99 %llu max %.1f mean %.1f overflow %llu missed %llu\n",
+             e->d, e->probe_nice, l->eventfd != -1 ? "eventfd" : "timer",
+             (unsigned long long)l->interval_ns / 1000, e->np, (unsigned long long)l->samples,
+             (unsigned long long)latency_pct(l, 50), (unsigned long long)latency_pct(l, 99),
+             l->max_ns / 1e3, (double)l->sum_ns / l->samples / 1e3,
+             (unsigned long long)l->overflow, (unsigned long long)l->missed);
+    printf("%s", line);
+
+    char path[64];
+    snprintf(path, sizeof(path), "%s/%c.latency", LOG_DIR, e->d);
+    FILE *f = fopen(path, "w");
+    if (f == NULL) {
+        perror(path);
+        return;
+    }
+    fputs(line, f);
+    fprintf(f, "# us count\n");
+    for (int b = 0; b < LATENCY_BUCKETS; b++) {
+        if (l->hist[b]) fprintf(f, "%d %u\n", b, l->hist[b]);
+    }
+    fclose(f);
+}
 
-    // Clean up child processes
-    for (int p = 0; p < e->np; p++) {
-        printf("Killing process with PID %d\n", e->child_pids[p]);
-        kill(e->child_pids[p], SIGKILL);
+// Allocate the child tables for n children of this part
+int brood(struct Experiment *e, int n) {
+    e->child_pids = malloc(n * sizeof(pid_t));
+    e->child_pidfds = malloc(n * sizeof(int));
+    e->child_perf = malloc(n * sizeof(struct PerfGroup));
+    if (e->child_pids == NULL || e->child_pidfds == NULL || e->child_perf == NULL) {
+        perror("Failed to allocate memory for child PIDs");
+        free(e->child_pids);
+        free(e->child_pidfds);
+        free(e->child_perf);
+        return -1;
+    }
+    for (int p = 0; p < n; p++) {
+        e->child_pidfds[p] = -1;
+        for (int k = 0; k < PERF_NEVENTS; k++) e->child_perf[p].fd[k] = -1;
     }
+    e->nchild = n;
+    e->pgid = 0;
+    return 0;
+}
 
-    // Free the memory allocated for child PIDs
-    free(e->child_pids);
+// Child side of a tracked fork: join the part's process group, take its
+// placement and policy, and find our slot on the board. The child then
+// sets itself up and waits for the part to start with await_go().
+void tracked_child(struct Experiment *e, int p) {
+    setpgid(0, e->pgid);
+    place(e, p);
+    struct Board *board = e->shm_ptr;
+    if (board == NULL) return;
+    my_board = board;
+    if (p < board->capacity) my_slot = &board->slots[p];
+    // The inherited cache describes the parent's chunk
+    arena_cache_init(&my_cache, e->arena);
+    my_history_ns = 0;
 }
 
-void parte_2(struct Experiment *e) {
-    int np = 1 + e->np; // N+1 processes
+// Parent side: keep a pidfd and counters for child p and let the overseer
+// know there is one more process to sample
+void track(struct Experiment *e, int p, pid_t pid) {
+    e->child_pids[p] = pid;
+    e->child_pidfds[p] = pidfd_open(pid, 0);
+    if (e->child_pidfds[p] == -1) perror("pidfd_open");
+    if (perf_group_open(&e->child_perf[p], pid) == -1) perror("perf_event_open");
+
+    struct Board *board = e->shm_ptr;
+    if (board != NULL && p < board->capacity) {
+        board->slots[p].pid = pid;
+        atomic_store_explicit(&board->count, p + 1, memory_order_release);
+    }
+}
 
-    // Allocate array to store child PIDs
-    e->child_pids = malloc(np * sizeof(pid_t));
-    if (e->child_pids == NULL) {
-        perror("Failed to allocate memory for child PIDs");
+// fork() for child p of the part. Every child joins one process group (the
+// first one leads it) and the parent keeps a pidfd for it, so the part can
+// be torn down with one signal and reaped as each pidfd turns readable.
+pid_t fork_tracked(struct Experiment *e, int p) {
+    fflush(stdout);
+    pid_t subid = fork();
+
+    if (subid == 0) {
+        tracked_child(e, p);
+    } else if (subid > 0) {
+        // Also from this side, so the group exists before fork() returns here
+        setpgid(subid, e->pgid);
+        if (e->pgid == 0) e->pgid = subid;
+        track(e, p, subid);
+    } else {
+        perror("fork failed");
+    }
+    return subid;
+}
+
+#define SPAWN_SERIAL_MAX 64 // parts with fewer children fork them one by one
+
+// Fork children first..first+count-1 of the part, each running body(e, p).
+// Large parts hand out slices to one spawner process per CPU: forking from
+// threads would serialize on our address space lock, separate processes
+// don't. The spawners exit when done, and since we are a subreaper their
+// children are reparented to us and reaped like any other.
+void spawn_children(struct Experiment *e, int first, int count, void (*body)(struct Experiment *, int)) {
+    if (count <= SPAWN_SERIAL_MAX) {
+        for (int p = first; p < first + count; p++) {
+            pid_t subid = fork_tracked(e, p);
+            if (subid == 0) {
+                body(e, p); // This will never return
+                exit(0);
+            } else if (subid > 0) {
+                printf("Started process %d with PID %d\n", p, subid);
+            }
+        }
         return;
     }
 
-    // Launch N+1 CPU-intensive processes
-    for (int p = 0; p < np; p++) {
-        pid_t subid = fork();
-        if (subid == 0) {
-            char nome[32];
-            snprintf(nome, 32, "%c_%d", e->d, p);
-            costume(nome);
-
-            // Create an experiment struct for this process
-            struct Experiment this_proc = { 0, e->d, "Monotono", 0, NULL, 0, 0, getpid(), NULL, -1 };
-            monotono(&this_proc); // This will never return
+    uint64_t start = clock_ns(CLOCK_MONOTONIC);
+    // The first child still comes from here, to lead the process group
+    if (e->pgid == 0) {
+        if (fork_tracked(e, first) == 0) {
+            body(e, first);
             exit(0);
+        }
+        first++;
+        count--;
+    }
+
+    pid_t *pids = mmap(NULL, count * sizeof(pid_t), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (pids == MAP_FAILED) {
+        perror("mmap spawn");
+        return;
+    }
+    int nspawners = nproc();
+    if (nspawners > count) nspawners = count;
+    pid_t *spawners = malloc(nspawners * sizeof(pid_t));
+
+    fflush(stdout);
+    for (int k = 0; k < nspawners; k++) {
+        int lo = (int)((int64_t)count * k / nspawners), hi = (int)((int64_t)count * (k + 1) / nspawners);
+        spawners[k] = fork();
+        if (spawners[k] == 0) {
+            for (int i = lo; i < hi; i++) {
+                pid_t subid = fork();
+                if (subid == 0) {
+                    tracked_child(e, first + i);
+                    body(e, first + i); // This will never return
+                    exit(0);
+                }
+                if (subid > 0) setpgid(subid, e->pgid);
+                pids[i] = subid;
+            }
+            _exit(0);
+        } else if (spawners[k] == -1) {
+            perror("fork spawner");
+            for (int i = lo; i < hi; i++) pids[i] = -1;
+        }
+    }
+    for (int k = 0; k < nspawners; k++) {
+        if (spawners[k] > 0) waitpid(spawners[k], NULL, 0);
+    }
+
+    // Every child is ours now; watch them in slot order
+    int started = 0;
+    for (int i = 0; i < count; i++) {
+        if (pids[i] > 0) {
+            track(e, first + i, pids[i]);
+            started++;
         } else {
-            e->child_pids[p] = subid;
-            printf("Started process %d with PID %d\n", p, subid);
+            e->child_pids[first + i] = -1;
         }
     }
+    printf("Started %d processes with %d spawners in %.1f ms\n", started, nspawners,
+           (clock_ns(CLOCK_MONOTONIC) - start) / 1e6);
+    free(spawners);
+    munmap(pids, count * sizeof(pid_t));
+}
+
+// CPU hog p of the part
+void hog(struct Experiment *e, int p) {
+    char nome[32];
+    snprintf(nome, 32, "%c_%d", e->d, p);
+    costume(nome);
+    monotono(NULL); // This will never return
+}
 
-    // Wait for the observer process to finish
+// Collect child p, whose pidfd is readable (so wait4 won't block), and
+// report the CPU time it got during the part
+void reap(struct Experiment *e, int epfd, int p) {
     int status;
-    waitpid(e->pidseer, &status, 0);
+    struct rusage ru;
+
+    epoll_ctl(epfd, EPOLL_CTL_DEL, e->child_pidfds[p], NULL);
+    close(e->child_pidfds[p]);
+    e->child_pidfds[p] = -1;
+    perf_group_close(&e->child_perf[p]);
+
+    if (wait4(e->child_pids[p], &status, 0, &ru) == -1) return;
+    printf("Reaped PID %d (%s %d): %.0f ms user, %.0f ms system\n", e->child_pids[p],
+           WIFSIGNALED(status) ? "signal" : "exit",
+           WIFSIGNALED(status) ? WTERMSIG(status) : WEXITSTATUS(status),
+           ru.ru_utime.tv_sec * 1e3 + ru.ru_utime.tv_usec / 1e3,
+           ru.ru_stime.tv_sec * 1e3 + ru.ru_stime.tv_usec / 1e3);
+}
 
-    printf("Observer process exited, cleaning up experiment processes\n");
-    fflush(stdout);
+// Exact CPU time, switches, migrations and IPC for every child still
+// running, then the same totals per nice level
+void perf_report(struct Experiment *e) {
+    struct PerfCounts by_nice[40];
+    int members[40] = { 0 };
+    memset(by_nice, 0, sizeof(by_nice));
+
+    printf("Part %c counters:\n", e->d);
+    for (int p = 0; p < e->nchild; p++) {
+        struct PerfCounts c;
+        if (e->child_pidfds[p] == -1 || perf_group_read(&e->child_perf[p], &c) == -1) continue;
+
+        errno = 0;
+        int nice = getpriority(PRIO_PROCESS, e->child_pids[p]);
+        if (errno != 0) nice = 0;
+
+        // Work done, from the child's own stats on the board
+        struct ChildSnapshot work = { 0 };
+        struct Board *board = e->shm_ptr;
+        if (board != NULL && p < board->capacity) stats_snapshot(&board->slots[p].stats, &work);
+
+        printf("  PID %d %-11s nice %3d: task-clock %9.1f ms, %6llu switches, %4llu migrations, %llu %s",
+               e->child_pids[p], policy_name(sched_getscheduler(e->child_pids[p])), nice,
+               c.value[PERF_TASK_CLOCK] / 1e6, (unsigned long long)c.value[PERF_CONTEXT_SWITCHES],
+               (unsigned long long)c.value[PERF_CPU_MIGRATIONS], (unsigned long long)work.iterations,
+               workload_units[workload]);
+        if (c.valid[PERF_INSTRUCTIONS] && c.valid[PERF_CYCLES] && c.value[PERF_CYCLES] > 0) {
+            printf(", IPC %.2f", (double)c.value[PERF_INSTRUCTIONS] / c.value[PERF_CYCLES]);
+        }
+        printf("\n");
 
-    // Clean up child processes
-    for (int p = 0; p < np; p++) {
-        printf("Killing process with PID %d\n", e->child_pids[p]);
-        kill(e->child_pids[p], SIGKILL);
+        struct PerfCounts *n = &by_nice[nice + 20];
+        for (int k = 0; k < PERF_NEVENTS; k++) {
+            n->value[k] += c.value[k];
+            n->valid[k] = c.valid[k];
+        }
+        members[nice + 20]++;
     }
 
-    // Free the memory allocated for child PIDs
-    free(e->child_pids);
+    for (int k = 0; k < 40; k++) {
+        if (members[k] == 0) continue;
+        struct PerfCounts *n = &by_nice[k];
+        printf("  nice %3d (%d): task-clock %9.1f ms, %6llu switches, %4llu migrations", k - 20, members[k],
+               n->value[PERF_TASK_CLOCK] / 1e6, (unsigned long long)n->value[PERF_CONTEXT_SWITCHES],
+               (unsigned long long)n->value[PERF_CPU_MIGRATIONS]);
+        if (n->valid[PERF_INSTRUCTIONS] && n->valid[PERF_CYCLES] && n->value[PERF_CYCLES] > 0) {
+            printf(", IPC %.2f", (double)n->value[PERF_INSTRUCTIONS] / n->value[PERF_CYCLES]);
+        }
+        printf("\n");
+    }
 }
 
-void parte_3(struct Experiment *e) {
-    int np = 1 + e->np; // N+1 processes
+#define SEER_EVENT UINT32_MAX
+#define POKE_EVENT (UINT32_MAX - 1)
+
+// Event loop for a running part: wait for the observer to finish (children
+// that die early are reaped on the way), then SIGKILL the whole process
+// group and reap every child as its pidfd becomes readable. No fixed sleeps.
+void supervise(struct Experiment *e) {
+    // Every child has been forked: let them all start at once
+    struct Board *board = e->shm_ptr;
+    if (board != NULL) {
+        atomic_store_explicit(&board->go, 1, memory_order_release);
+        futex(&board->go, FUTEX_WAKE, INT_MAX);
+    }
 
-    // Allocate array to store child PIDs
-    e->child_pids = malloc(np * sizeof(pid_t));
-    if (e->child_pids == NULL) {
-        perror("Failed to allocate memory for child PIDs");
+    int epfd = epoll_create1(EPOLL_CLOEXEC);
+    if (epfd == -1) {
+        perror("epoll_create1");
         return;
     }
 
-    // Launch N+1 CPU-intensive processes
-    for (int p = 0; p < np; p++) {
-        pid_t subid = fork();
-        if (subid == 0) {
-            char nome[32];
-            snprintf(nome, 32, "%c_%d", e->d, p);
-            costume(nome);
-            monotono(NULL); // This will never return
-            exit(0);
-        } else {
-            e->child_pids[p] = subid;
-            printf("Started process %d with PID %d\n", p, subid);
-        }
+    int alive = 0;
+    for (int p = 0; p < e->nchild; p++) {
+        if (e->child_pidfds[p] == -1) continue;
+        struct epoll_event ev = { .events = EPOLLIN, .data.u32 = p };
+        epoll_ctl(epfd, EPOLL_CTL_ADD, e->child_pidfds[p], &ev);
+        alive++;
     }
 
-    // Increase priority of process 5 (or the last one if np < 5)
-    int target_proc = (5 < np) ? 5 : np - 1;
-    pid_t renice_pid = fork();
-    if (renice_pid == 0) {
-        char cmd[64];
-        snprintf(cmd, sizeof(cmd), "renice -n -10 -p %d", e->child_pids[target_proc]);
-        printf("Running: %s\n", cmd);
-        shell(-1, cmd, "renice");
-        exit(0);
-    } else {
-        // Wait for the renice process to complete
-        int status;
-        waitpid(renice_pid, &status, 0);
+    int seerfd = e->pidseer > 0 ? pidfd_open(e->pidseer, 0) : -1;
+    if (seerfd != -1) {
+        struct epoll_event ev = { .events = EPOLLIN, .data.u32 = SEER_EVENT };
+        epoll_ctl(epfd, EPOLL_CTL_ADD, seerfd, &ev);
     }
 
-    // Wait for the observer process to finish
-    waitpid(e->pidseer, NULL, 0);
+    // Poke an eventfd-driven latency probe every interval
+    int pokefd = -1;
+    if (e->latency != NULL && e->latency->eventfd != -1) {
+        uint64_t ns = e->latency->interval_ns;
+        struct itimerspec its = { { 0, ns }, { 0, ns } };
+        pokefd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
+        if (pokefd == -1 || timerfd_settime(pokefd, 0, &its, NULL) == -1) perror("timerfd poke");
+        struct epoll_event ev = { .events = EPOLLIN, .data.u32 = POKE_EVENT };
+        epoll_ctl(epfd, EPOLL_CTL_ADD, pokefd, &ev);
+    }
 
-    printf("Observer process exited, cleaning up experiment processes\n");
-    fflush(stdout);
+    bool killed = false;
+    while (seerfd != -1 || alive > 0) {
+        if (seerfd == -1 && !killed) {
+            printf("Observer process exited, cleaning up experiment processes\n");
+            perf_report(e);
+            fflush(stdout);
+            if (e->pgid > 0) killpg(e->pgid, SIGKILL);
+            killed = true;
+        }
 
-    // Clean up child processes
-    for (int p = 0; p < np; p++) {
-        printf("Killing process with PID %d\n", e->child_pids[p]);
-        kill(e->child_pids[p], SIGKILL);
+        struct epoll_event evs[256];
+        int n = epoll_wait(epfd, evs, 256, -1);
+        if (n == -1) {
+            if (errno == EINTR) continue;
+            perror("epoll_wait");
+            break;
+        }
+
+        for (int k = 0; k < n; k++) {
+            if (evs[k].data.u32 == POKE_EVENT) {
+                uint64_t expirations, one = 1;
+                if (read(pokefd, &expirations, sizeof(expirations)) < 0) continue;
+                if (killed) continue;
+                // Stamp only a poke the probe will read first, so its latency
+                // counts from the oldest one it hasn't answered
+                uint64_t idle = 0;
+                atomic_compare_exchange_strong_explicit(&e->latency->poke_ns, &idle, clock_ns(CLOCK_MONOTONIC),
+                                                        memory_order_release, memory_order_relaxed);
+                if (write(e->latency->eventfd, &one, sizeof(one)) < 0) perror("write eventfd");
+                continue;
+            }
+            if (evs[k].data.u32 == SEER_EVENT) {
+                waitpid(e->pidseer, NULL, 0);
+                epoll_ctl(epfd, EPOLL_CTL_DEL, seerfd, NULL);
+                close(seerfd);
+                seerfd = -1;
+                e->pidseer = -1;
+                continue;
+            }
+            if (!killed) printf("Process %d exited before the observer finished\n", e->child_pids[evs[k].data.u32]);
+            reap(e, epfd, evs[k].data.u32);
+            alive--;
+        }
     }
 
-    // Free the memory allocated for child PIDs
+    close(epfd);
+    if (pokefd != -1) close(pokefd);
+    if (e->shm_ptr != NULL) {
+        history_report(e);
+        arena_destroy(e->arena, e->shm_id);
+        e->arena = NULL;
+        e->shm_id = -1;
+        e->shm_ptr = NULL;
+    }
     free(e->child_pids);
+    free(e->child_pidfds);
+    free(e->child_perf);
+    e->child_pids = NULL;
+    e->child_pidfds = NULL;
+    e->child_perf = NULL;
+}
+
+void parte_1(struct Experiment *e) {
+    if (brood(e, e->np) == -1) return;
+
+    // Launch N CPU-intensive processes
+    spawn_children(e, 0, e->np, hog);
+
+    supervise(e);
+}
+
+// CPU hog p, named after the part it belongs to
+void named_hog(struct Experiment *e, int p) {
+    char nome[32];
+    snprintf(nome, 32, "%c_%d", e->d, p);
+    costume(nome);
+
+    // Create an experiment struct for this process
+    struct Experiment this_proc = { .d = e->d, .desc = "Monotono", .pid = getpid(), .pidseer = -1, .shm_id = -1 };
+    monotono(&this_proc); // This will never return
+}
+
+void parte_2(struct Experiment *e) {
+    int np = 1 + e->np; // N+1 processes
+    if (brood(e, np) == -1) return;
+
+    // Launch N+1 CPU-intensive processes
+    spawn_children(e, 0, np, named_hog);
+
+    supervise(e);
+}
+
+void parte_3(struct Experiment *e) {
+    int np = 1 + e->np; // N+1 processes
+    if (brood(e, np) == -1) return;
+
+    // Launch N+1 CPU-intensive processes
+    spawn_children(e, 0, np, hog);
+
+    // Increase priority of process 5 (or the last one if np < 5), as
+    // renice -n -10 -p would
+    int target_proc = (5 < np) ? 5 : np - 1;
+    printf("Setting nice -10 on PID %d\n", e->child_pids[target_proc]);
+    if (setpriority(PRIO_PROCESS, e->child_pids[target_proc], -10) == -1) perror("setpriority");
+
+    supervise(e);
 }
 
 void parte_4(struct Experiment *e) {
-    // Allocate array to store child PIDs
-    e->child_pids = malloc((e->np + 1) * sizeof(pid_t)); // +1 for the blocking process
-    if (e->child_pids == NULL) {
-        perror("Failed to allocate memory for child PIDs");
-        return;
-    }
+    if (brood(e, e->np + 1) == -1) return; // +1 for the blocking process
 
     // Launch N CPU-intensive processes
-    for (int p = 0; p < e->np; p++) {
-        pid_t subid = fork();
-        if (subid == 0) {
-            char nome[32];
-            snprintf(nome, 32, "%c_%d", e->d, p);
-            costume(nome);
-            monotono(NULL); // This will never return
-            exit(0);
-        } else {
-            e->child_pids[p] = subid;
-            printf("Started CPU-intensive process %d with PID %d\n", p, subid);
-        }
-    }
+    spawn_children(e, 0, e->np, hog);
 
     // Create a named pipe for communication with the blocking process
     char fifo_path[64];
@@ -392,8 +1482,9 @@ void parte_4(struct Experiment *e) {
     mkdir(LOG_DIR, 0755);
 
     // Launch blocking process
-    pid_t blocking_pid = fork();
+    pid_t blocking_pid = fork_tracked(e, e->np);
     if (blocking_pid == 0) {
+        await_go();
         costume("blocking_io");
 
         // Redirect stdin to our named pipe
@@ -408,49 +1499,185 @@ void parte_4(struct Experiment *e) {
         execve("/bin/bash", argv, environ);
         perror("execve blocking.sh");
         exit(1);
-    } else {
-        e->child_pids[e->np] = blocking_pid;
+    } else if (blocking_pid > 0) {
         printf("Started blocking process with PID %d\n", blocking_pid);
     }
 
-    // Wait for the observer process to finish
-    waitpid(e->pidseer, NULL, 0);
+    supervise(e);
+    unlink(fifo_path);
+}
 
-    printf("Observer process exited, cleaning up experiment processes\n");
-    fflush(stdout);
+// N+1 CPU hogs under the part's placement and policy (applied by place()
+// in each child); the counters and board report what each one got
+void parte_sched(struct Experiment *e) {
+    int np = 1 + e->np;
+    if (brood(e, np) == -1) return;
+
+    printf("%s: %d processes, first %d under %s\n", e->desc, np, (np + 1) / 2, policy_name(e->policy));
+    spawn_children(e, 0, np, hog);
+
+    supervise(e);
+}
+
+// np CPU hogs plus a latency probe, which reports how long it waits for
+// the CPU each time it wakes up
+void parte_latency(struct Experiment *e) {
+    if (brood(e, e->np + 1) == -1) return;
+    e->latency = latency_create(e->probe_event);
+    if (e->latency == NULL) return;
 
-    // Give some time for the ps command to finish observing
-    sleep(1);
+    spawn_children(e, 0, e->np, hog);
 
-    // Clean up child processes (N CPU-intensive + 1 blocking)
-    for (int p = 0; p <= e->np; p++) {
-        printf("Killing process with PID %d\n", e->child_pids[p]);
-        kill(e->child_pids[p], SIGKILL);
+    pid_t probe = fork_tracked(e, e->np);
+    if (probe == 0) {
+        await_go();
+        costume("latency");
+        latency_probe(e); // This will never return
+        exit(0);
+    } else if (probe > 0) {
+        printf("Started latency probe with PID %d (nice %d)\n", probe, e->probe_nice);
     }
 
-    // Free the memory allocated for child PIDs
-    free(e->child_pids);
+    supervise(e);
+    latency_report(e);
+    if (e->latency->eventfd != -1) close(e->latency->eventfd);
+    munmap(e->latency, sizeof(struct Latency));
+    e->latency = NULL;
 }
 
-int main() {
+int main(int argc, char *argv[]) {
+    int hogs = 0;
+    for (int a = 1; a < argc; a++) {
+        if (strcmp(argv[a], "-f") == 0) {
+            seer_fifo = true;
+        } else if (strcmp(argv[a], "-t") == 0) {
+            text_logs = true;
+        } else if (strcmp(argv[a], "-s") == 0) {
+            sched_parts = true;
+        } else if (strcmp(argv[a], "-l") == 0) {
+            latency_parts = true;
+        } else if (strcmp(argv[a], "-n") == 0 && a + 1 < argc) {
+            hogs = atoi(argv[++a]);
+        } else if (strcmp(argv[a], "-w") == 0 && a + 1 < argc && workload_parse(argv[a + 1]) != -1) {
+            workload = workload_parse(argv[++a]);
+        } else {
+            fprintf(stderr, "usage: %s [-f] [-t] [-s] [-l] [-n N] [-w KERNEL]\n"
+                            "  -f  run the overseer as SCHED_FIFO\n"
+                            "  -t  also write one text log per observation\n"
+                            "  -s  also run the affinity and scheduling policy parts\n"
+                            "  -l  also run the wakeup latency parts\n"
+                            "  -n  use N instead of the CPU count as the number of hogs\n"
+                            "  -w  workload of the hogs: scalar (default), fma, stream, chase,\n"
+                            "      l2thrash or l3thrash\n", argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    // Anything our children leave behind is reparented to us, not to init
+    if (prctl(PR_SET_CHILD_SUBREAPER, 1, 0, 0, 0) == -1) {
+        perror("prctl(PR_SET_CHILD_SUBREAPER)");
+    }
+
     int np = nproc();
     printf("Detected %d processor cores\n", np);
+    if (hogs > 0) {
+        np = hogs;
+        printf("Running %d processes per part\n", np);
+    }
 
-    struct Experiment parte1 = { 1, '1', "Parte 1", np, parte_1, 10, 500, 0, NULL, -1 };
-    struct Experiment parte2 = { 2, '2', "Parte 2", np, parte_2, 10, 500, 0, NULL, -1 };
-    struct Experiment parte3 = { 3, '3', "Parte 3", np, parte_3, 10, 500, 0, NULL, -1 };
-    struct Experiment parte4 = { 4, '4', "Parte 4", np, parte_4, 10, 500, 0, NULL, -1 };
+    // Every child costs the driver a pidfd and a perf group, and the
+    // overseer three /proc fds and another perf group
+    struct rlimit nofile;
+    if (getrlimit(RLIMIT_NOFILE, &nofile) == 0 && nofile.rlim_cur < nofile.rlim_max) {
+        nofile.rlim_cur = nofile.rlim_max;
+        if (setrlimit(RLIMIT_NOFILE, &nofile) == -1) perror("setrlimit(RLIMIT_NOFILE)");
+    }
+
+    // Every memory-bound hog maps buffers of its own: give the N+1 of a part
+    // at most half the available memory between them
+    size_t per_hog = workload_bytes(workload, WORKLOAD_MAX_BYTES), avail = mem_available();
+    if (per_hog > 0 && avail > 0 && avail / 2 / (np + 1) < per_hog) {
+        workload_max_bytes = avail / 2 / (np + 1);
+        if (workload_max_bytes < WORKLOAD_MIN_BYTES) {
+            fprintf(stderr, "%d %s hogs don't fit in %zu MiB of available memory\n", np + 1,
+                    workload_names[workload], avail >> 20);
+            return EXIT_FAILURE;
+        }
+        printf("Each %s hog maps %.1f MiB instead of %.1f MiB, for %d of them to fit in memory\n",
+               workload_names[workload], workload_bytes(workload, workload_max_bytes) / 1048576.0,
+               per_hog / 1048576.0, np + 1);
+    }
 
-    struct Experiment *partes[] = { &parte1, &parte2, &parte3, &parte4 };
-    int npartes = sizeof(partes) / sizeof(partes[0]);
+    struct Experiment parte1 = { .r = 1, .d = '1', .desc = "Parte 1", .np = np, .task = parte_1,
+                                  .no = 10, .io = 500, .pidseer = -1, .shm_id = -1 };
+    struct Experiment parte2 = { .r = 2, .d = '2', .desc = "Parte 2", .np = np, .task = parte_2,
+                                  .no = 10, .io = 500, .pidseer = -1, .shm_id = -1 };
+    struct Experiment parte3 = { .r = 3, .d = '3', .desc = "Parte 3", .np = np, .task = parte_3,
+                                  .no = 10, .io = 500, .pidseer = -1, .shm_id = -1 };
+    struct Experiment parte4 = { .r = 4, .d = '4', .desc = "Parte 4", .np = np, .task = parte_4,
+                                  .no = 10, .io = 500, .pidseer = -1, .shm_id = -1 };
+
+    // Placement and policy parts (-s), N+1 hogs each
+    static const struct { char d; enum Placement placement; int policy; const char *desc; } variants[] = {
+        { 'a', PLACE_ONE_CORE, SCHED_OTHER, "One core, SCHED_OTHER" },
+        { 'b', PLACE_PER_CORE, SCHED_OTHER, "One per core, SCHED_OTHER" },
+        { 'c', PLACE_SMT_SIBLINGS, SCHED_OTHER, "SMT siblings, SCHED_OTHER" },
+        { 'd', PLACE_ONE_CORE, SCHED_BATCH, "One core, SCHED_BATCH" },
+        { 'e', PLACE_ONE_CORE, SCHED_IDLE, "One core, SCHED_IDLE" },
+        { 'f', PLACE_ONE_CORE, SCHED_FIFO, "One core, SCHED_FIFO" },
+        { 'g', PLACE_ONE_CORE, SCHED_RR, "One core, SCHED_RR" },
+    };
+    int nvariants = sizeof(variants) / sizeof(variants[0]);
+    struct Experiment sched[sizeof(variants) / sizeof(variants[0])];
+
+    // Wakeup latency parts (-l): a probe next to N or N+1 hogs
+    static const struct { char d; int extra; int nice; bool event; const char *desc; } probes[] = {
+        { 'l', 0, 0, false, "Latency, N hogs" },
+        { 'm', 1, 0, false, "Latency, N+1 hogs" },
+        { 'n', 1, -10, false, "Latency, N+1 hogs, probe nice -10" },
+        { 'o', 1, 10, false, "Latency, N+1 hogs, probe nice 10" },
+        { 'p', 1, 0, true, "Latency, N+1 hogs, eventfd wakeups" },
+    };
+    int nprobes = sizeof(probes) / sizeof(probes[0]);
+    struct Experiment latency[sizeof(probes) / sizeof(probes[0])];
+
+    struct Experiment *partes[4 + sizeof(variants) / sizeof(variants[0]) + sizeof(probes) / sizeof(probes[0])] = {
+        &parte1, &parte2, &parte3, &parte4
+    };
+    int npartes = 4;
+    for (int v = 0; sched_parts && v < nvariants; v++) {
+        sched[v] = (struct Experiment){ .r = 5 + v, .d = variants[v].d, .np = np, .task = parte_sched,
+                                        .no = 10, .io = 500, .pidseer = -1, .shm_id = -1,
+                                        .placement = variants[v].placement, .policy = variants[v].policy };
+        snprintf(sched[v].desc, sizeof(sched[v].desc), "%s", variants[v].desc);
+        partes[npartes++] = &sched[v];
+    }
+    for (int v = 0; latency_parts && v < nprobes; v++) {
+        latency[v] = (struct Experiment){ .r = 5 + nvariants + v, .d = probes[v].d, .np = np + probes[v].extra,
+                                          .task = parte_latency, .no = 10, .io = 500, .pidseer = -1,
+                                          .shm_id = -1, .probe_nice = probes[v].nice,
+                                          .probe_event = probes[v].event };
+        snprintf(latency[v].desc, sizeof(latency[v].desc), "%s", probes[v].desc);
+        partes[npartes++] = &latency[v];
+    }
+
+    // One record per tracked child per observation, N+1 children at most
+    uint64_t capacity = 0;
+    for (int o = 0; o < npartes; o++) capacity += (uint64_t)partes[o]->no * (partes[o]->np + 1);
+    mkdir(LOG_DIR, 0755);
+    samplelog_create(SAMPLELOG_PATH, capacity);
+    if (samplelog != NULL) snprintf(samplelog->workload, sizeof(samplelog->workload), "%s", workload_names[workload]);
+    printf("Workload: %s (throughput in %s/s)\n", workload_names[workload], workload_units[workload]);
 
+    // Every child of a part is reaped before supervise() returns, so the
+    // next part starts on a quiet machine without a fixed pause
     for (int o = 0; o < npartes; o++) {
         struct Experiment *currex = partes[o];
         pseer(currex);
         currex->task(currex);
-        sleep(2);
     }
 
+    samplelog_close();
     printf("All experiments completed\n");
     return 0;
 }
@@ -0,0 +1,334 @@
+// Workload kernels for spawn's CPU hogs (selected with spawn -w).
+//
+// Each kernel does its work in steps; workload_calibrate() sizes a step to
+// take about WORKLOAD_STEP_US and workload_run() publishes the kernel's own
+// units (iterations, flops, bytes, loads, cache lines) after every one of
+// them, so the overseer sees each workload class's throughput as it is
+// co-scheduled.
+//
+//   scalar   the original monotono loop                      iterations
+//   fma      8 independent FMA chains, AVX2 (SSE fallback)   flops
+//   stream   STREAM triad a = b + s*c over arrays >> LLC     bytes
+//   chase    dependent loads around a random cycle >> LLC    loads
+//   l2thrash read-modify-write every line of an L2-sized buffer   lines
+//   l3thrash the same over an LLC-sized buffer                     lines
+//
+// Buffer sizes come from /sys/devices/system/cpu/cpu0/cache; memory-bound
+// footprints are capped per process by the caller, at most WORKLOAD_MAX_BYTES.
+#ifndef WORKLOAD_H
+#define WORKLOAD_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+#include "seqlock.h"
+
+#define WORKLOAD_STEP_US 200
+#define WORKLOAD_MAX_BYTES (256ull << 20)
+#define WORKLOAD_MIN_BYTES (1ull << 20)   // smallest cap a memory-bound kernel is worth running with
+
+enum Workload {
+    WORKLOAD_SCALAR,
+    WORKLOAD_FMA,
+    WORKLOAD_STREAM,
+    WORKLOAD_CHASE,
+    WORKLOAD_L2THRASH,
+    WORKLOAD_L3THRASH,
+    WORKLOAD_COUNT,
+};
+
+struct WorkloadState {
+    enum Workload kind;
+    uint64_t i;                 // scalar: next loop index
+    double *a, *b, *c;          // stream arrays
+    uint32_t *next;             // chase: next[16 * k] is the line after line k
+    uint32_t at;                // chase: current slot
+    char *buf;                  // thrash buffer
+    size_t n;                   // elements in a/b/c, lines in next or buf
+    size_t pos;                 // where the next step resumes
+    double sink;                // results, kept so the work isn't optimized out
+};
+
+// Size in bytes of the largest data or unified cache at level, 0 if unknown
+static inline size_t cache_size(int level) {
+    size_t best = 0;
+    for (int k = 0;; k++) {
+        char path[96], buf[32];
+        int found = 0;
+        size_t size = 0;
+
+        snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu0/cache/index%d/level", k);
+        FILE *f = fopen(path, "r");
+        if (f == NULL) break;
+        if (fgets(buf, sizeof(buf), f) && atoi(buf) == level) found = 1;
+        fclose(f);
+
+        snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu0/cache/index%d/type", k);
+        f = fopen(path, "r");
+        if (f && fgets(buf, sizeof(buf), f) && strncmp(buf, "Instruction", 11) == 0) found = 0;
+        if (f) fclose(f);
+
+        snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu0/cache/index%d/size", k);
+        f = fopen(path, "r");
+        if (f && fgets(buf, sizeof(buf), f)) {
+            char *unit;
+            size = strtoull(buf, &unit, 10);
+            if (*unit == 'K') size <<= 10;
+            if (*unit == 'M') size <<= 20;
+        }
+        if (f) fclose(f);
+
+        if (found && size > best) best = size;
+    }
+    return best;
+}
+
+// Largest cache level present (the LLC), falling back to 8 MiB
+static inline size_t llc_size(void) {
+    for (int level = 4; level >= 1; level--) {
+        size_t size = cache_size(level);
+        if (size) return size;
+    }
+    return 8 << 20;
+}
+
+static inline void *workload_alloc(size_t bytes) {
+    void *p = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE, -1, 0);
+    if (p == MAP_FAILED) {
+        perror("mmap workload");
+        return NULL;
+    }
+    return p;
+}
+
+static const char *workload_names[WORKLOAD_COUNT] = {
+    "scalar", "fma", "stream", "chase", "l2thrash", "l3thrash",
+};
+
+static const char *workload_units[WORKLOAD_COUNT] = {
+    "iterations", "flops", "bytes", "loads", "lines", "lines",
+};
+
+static inline int workload_parse(const char *name) {
+    for (int w = 0; w < WORKLOAD_COUNT; w++) {
+        if (strcmp(name, workload_names[w]) == 0) return w;
+    }
+    return -1;
+}
+
+// Bytes of buffers one process of the kernel maps, at most max_bytes
+static inline size_t workload_bytes(enum Workload kind, size_t max_bytes) {
+    size_t bytes;
+    switch (kind) {
+        case WORKLOAD_STREAM:
+            // Three arrays, together well beyond the LLC
+            bytes = llc_size() * 4 / 3 * 3;
+            break;
+        case WORKLOAD_CHASE:
+            bytes = llc_size() * 4;
+            break;
+        case WORKLOAD_L2THRASH:
+        case WORKLOAD_L3THRASH:
+            bytes = cache_size(kind == WORKLOAD_L2THRASH ? 2 : 3);
+            if (bytes == 0) bytes = kind == WORKLOAD_L2THRASH ? 1 << 20 : llc_size();
+            break;
+        default:
+            return 0;
+    }
+    return bytes < max_bytes ? bytes : max_bytes;
+}
+
+// Allocate and initialize the kernel's buffers, max_bytes of them at most
+static inline int workload_setup(struct WorkloadState *s, enum Workload kind, size_t max_bytes) {
+    memset(s, 0, sizeof(*s));
+    s->kind = kind;
+    size_t bytes = workload_bytes(kind, max_bytes);
+
+    switch (kind) {
+        case WORKLOAD_STREAM:
+            bytes /= 3;
+            s->n = bytes / sizeof(double);
+            s->a = workload_alloc(bytes);
+            s->b = workload_alloc(bytes);
+            s->c = workload_alloc(bytes);
+            if (!s->a || !s->b || !s->c) return -1;
+            for (size_t k = 0; k < s->n; k++) {
+                s->b[k] = 1.0;
+                s->c[k] = 2.0;
+            }
+            break;
+        case WORKLOAD_CHASE:
+            // One slot per cache line, so every load misses a new line
+            s->n = bytes / 64;
+            s->next = workload_alloc(bytes);
+            uint32_t *cycle = malloc(s->n * sizeof(uint32_t));
+            if (s->next == NULL || cycle == NULL) return -1;
+            // Sattolo's shuffle gives one cycle through every slot, in
+            // random order, so the prefetchers can't guess the next load.
+            // Shuffled compactly, then scattered into the lines.
+            for (size_t k = 0; k < s->n; k++) cycle[k] = k;
+            uint64_t x = 0x9e3779b97f4a7c15ull ^ getpid();
+            for (size_t k = s->n - 1; k > 0; k--) {
+                x ^= x << 13;
+                x ^= x >> 7;
+                x ^= x << 17;
+                size_t j = x % k;
+                uint32_t t = cycle[k];
+                cycle[k] = cycle[j];
+                cycle[j] = t;
+            }
+            for (size_t k = 0; k < s->n; k++) s->next[k * 16] = cycle[k];
+            free(cycle);
+            break;
+        case WORKLOAD_L2THRASH:
+        case WORKLOAD_L3THRASH:
+            s->n = bytes / 64;
+            s->buf = workload_alloc(bytes);
+            if (s->buf == NULL) return -1;
+            break;
+        default:
+            break;
+    }
+    return 0;
+}
+
+static inline uint64_t step_scalar(struct WorkloadState *s, uint64_t reps) {
+    volatile double result = 0.0;
+    for (uint64_t k = 0; k < reps; k++, s->i++) {
+        if (s->i == 10000000) s->i = 0; // the original loop's bound
+        result += (double)s->i * s->i / (s->i + 1.0);
+    }
+    s->sink += result;
+    return reps;
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+// 8 chains of 8-wide FMAs: enough independent work to fill both FMA ports
+__attribute__((target("avx2,fma"))) static inline uint64_t step_fma_avx2(struct WorkloadState *s, uint64_t reps) {
+    __m256 x = _mm256_set1_ps(0.999f), y = _mm256_set1_ps(0.001f);
+    __m256 acc[8];
+    for (int k = 0; k < 8; k++) acc[k] = _mm256_set1_ps((float)k);
+    for (uint64_t r = 0; r < reps; r++) {
+        for (int k = 0; k < 8; k++) acc[k] = _mm256_fmadd_ps(acc[k], x, y);
+    }
+    float out[8];
+    for (int k = 1; k < 8; k++) acc[0] = _mm256_add_ps(acc[0], acc[k]);
+    _mm256_storeu_ps(out, acc[0]);
+    s->sink += out[0];
+    return reps * 8 * 8 * 2;
+}
+
+// SSE has no FMA: a multiply and an add on 4 lanes
+static inline uint64_t step_fma_sse(struct WorkloadState *s, uint64_t reps) {
+    __m128 x = _mm_set1_ps(0.999f), y = _mm_set1_ps(0.001f);
+    __m128 acc[8];
+    for (int k = 0; k < 8; k++) acc[k] = _mm_set1_ps((float)k);
+    for (uint64_t r = 0; r < reps; r++) {
+        for (int k = 0; k < 8; k++) acc[k] = _mm_add_ps(_mm_mul_ps(acc[k], x), y);
+    }
+    float out[4];
+    for (int k = 1; k < 8; k++) acc[0] = _mm_add_ps(acc[0], acc[k]);
+    _mm_storeu_ps(out, acc[0]);
+    s->sink += out[0];
+    return reps * 8 * 4 * 2;
+}
+#endif
+
+static inline uint64_t step_fma(struct WorkloadState *s, uint64_t reps) {
+#if defined(__x86_64__) || defined(__i386__)
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) return step_fma_avx2(s, reps);
+    return step_fma_sse(s, reps);
+#else
+    float acc[8] = { 0, 1, 2, 3, 4, 5, 6, 7 };
+    for (uint64_t r = 0; r < reps; r++) {
+        for (int k = 0; k < 8; k++) acc[k] = acc[k] * 0.999f + 0.001f;
+    }
+    s->sink += acc[0];
+    return reps * 8 * 2;
+#endif
+}
+
+// One rep is a 4096-element slice of the triad
+static inline uint64_t step_stream(struct WorkloadState *s, uint64_t reps) {
+    const double scalar = 3.0;
+    uint64_t elements = 0;
+    for (uint64_t r = 0; r < reps; r++) {
+        size_t end = s->pos + 4096 < s->n ? s->pos + 4096 : s->n;
+        for (size_t k = s->pos; k < end; k++) s->a[k] = s->b[k] + scalar * s->c[k];
+        elements += end - s->pos;
+        s->pos = end == s->n ? 0 : end;
+    }
+    s->sink += s->a[0];
+    return elements * 3 * sizeof(double);
+}
+
+// One rep is 1024 dependent loads
+static inline uint64_t step_chase(struct WorkloadState *s, uint64_t reps) {
+    uint32_t at = s->at;
+    for (uint64_t r = 0; r < reps * 1024; r++) at = s->next[(size_t)at * 16];
+    s->at = at;
+    return reps * 1024;
+}
+
+// One rep touches 1024 cache lines, read and write
+static inline uint64_t step_thrash(struct WorkloadState *s, uint64_t reps) {
+    for (uint64_t r = 0; r < reps * 1024; r++) {
+        s->buf[s->pos * 64]++;
+        if (++s->pos == s->n) s->pos = 0;
+    }
+    return reps * 1024;
+}
+
+static inline uint64_t workload_step(struct WorkloadState *s, uint64_t reps) {
+    switch (s->kind) {
+        case WORKLOAD_FMA: return step_fma(s, reps);
+        case WORKLOAD_STREAM: return step_stream(s, reps);
+        case WORKLOAD_CHASE: return step_chase(s, reps);
+        case WORKLOAD_L2THRASH:
+        case WORKLOAD_L3THRASH: return step_thrash(s, reps);
+        default: return step_scalar(s, reps);
+    }
+}
+
+static inline uint64_t workload_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+// Reps per step for about WORKLOAD_STEP_US, timed on the set-up kernel.
+// Whatever else runs meanwhile stretches the timing and shortens the step.
+static inline uint64_t workload_calibrate(struct WorkloadState *s) {
+    uint64_t reps = 1;
+    for (;;) {
+        uint64_t t = workload_now_ns();
+        workload_step(s, reps);
+        if (workload_now_ns() - t >= WORKLOAD_STEP_US * 1000ull / 2 || reps >= (1ull << 40)) break;
+        reps *= 2;
+    }
+    return reps;
+}
+
+// Run the kernel forever in steps of reps, publishing its units to stats
+// (if any) and handing them to on_step (if any) after every step. The step
+// size stays fixed, so steps get longer when the process gets less CPU.
+static inline void workload_run(struct WorkloadState *s, uint64_t reps, struct ChildStats *stats,
+                                void (*on_step)(uint64_t done, uint32_t phase, uint64_t now_ns)) {
+    uint64_t done = 0;
+    for (uint32_t phase = 0;; phase++) {
+        done += workload_step(s, reps);
+        uint64_t now = workload_now_ns();
+        if (stats != NULL) stats_publish(stats, done, phase, now);
+        if (on_step != NULL) on_step(done, phase, now);
+    }
+}
+
+#endif
@@ -3,6 +3,9 @@
  * 
  * This implementation uses condition variables to efficiently signal
  * when buffer status changes (not empty/not full).
+ *
+ * Usage: ./condition_var_solution            timed demo for RUNTIME_SECONDS
+ *        ./condition_var_solution <items>    run-to-completion (drain) mode
  */
 
 #include <stdio.h>
@@ -10,11 +13,16 @@
 #include <pthread.h>
 #include <unistd.h>
 #include <time.h>
+#include <limits.h>
+#include <sys/resource.h>
 
 #define TAMANHO 10
 #define NUM_CONSUMIDORES 2
 #define RUNTIME_SECONDS 5
 
+// Poison pill: one per consumer is enqueued after the last item in drain mode
+#define PILULA (-1)
+
 volatile int dados[TAMANHO];
 volatile size_t inserir = 0;
 volatile size_t remover = 0;
@@ -27,32 +35,57 @@ pthread_mutex_t buffer_mutex = PTHREAD_MUTEX_INITIALIZER;
 pthread_cond_t not_empty = PTHREAD_COND_INITIALIZER;
 pthread_cond_t not_full = PTHREAD_COND_INITIALIZER;
 
+// Drain mode: 0 keeps the timed demo, otherwise exact number of items
+size_t total_itens = 0;
+
+// Per-thread accounting, each slot written only by its own thread
+size_t consumidos[NUM_CONSUMIDORES];
+double cpu_consumidor[NUM_CONSUMIDORES];
+double cpu_produtor;
+
+double agora(clockid_t clock) {
+    struct timespec ts;
+    clock_gettime(clock, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+void inserir_item(int v) {
+    // Acquire the lock
+    pthread_mutex_lock(&buffer_mutex);
+
+    // Wait while the buffer is full
+    while (count == TAMANHO - 1) {
+        pthread_cond_wait(&not_full, &buffer_mutex);
+    }
+
+    // Critical section - insert into buffer
+    if (!total_itens) printf("Produzindo %d\n", v);
+    dados[inserir] = v;
+    inserir = (inserir + 1) % TAMANHO;
+    count++;
+
+    // Signal that the buffer is not empty anymore
+    pthread_cond_signal(&not_empty);
+
+    // Release the lock
+    pthread_mutex_unlock(&buffer_mutex);
+}
+
 void *produtor(void *arg) {
-    int v;
-    for (v = 1;; v++) {
-        // Acquire the lock
-        pthread_mutex_lock(&buffer_mutex);
-        
-        // Wait while the buffer is full
-        while (count == TAMANHO - 1) {
-            pthread_cond_wait(&not_full, &buffer_mutex);
-        }
-        
-        // Critical section - insert into buffer
-        printf("Produzindo %d\n", v);
-        dados[inserir] = v;
-        inserir = (inserir + 1) % TAMANHO;
-        count++;
-        
-        // Signal that the buffer is not empty anymore
-        pthread_cond_signal(&not_empty);
+    // Counted in size_t so the last item, INT_MAX at most, doesn't overflow v
+    size_t v;
+    for (v = 1; !total_itens || v <= total_itens; v++) {
+        inserir_item((int)v);
         
-        // Release the lock
-        pthread_mutex_unlock(&buffer_mutex);
-        
-        usleep(500000);  // Sleep for 500ms
+        if (!total_itens) usleep(500000);  // Sleep for 500ms
     }
     
+    // Only reached in drain mode: tell every consumer to stop
+    for (size_t i = 0; i < NUM_CONSUMIDORES; i++) {
+        inserir_item(PILULA);
+    }
+
+    cpu_produtor = agora(CLOCK_THREAD_CPUTIME_ID);
     return NULL;
 }
 
@@ -71,7 +104,7 @@ void *consumidor(void *arg) {
         
         // Critical section - consume from buffer
         data = dados[remover];
-        printf("Consumidor %zu: Consumindo %d\n", consumer_id, data);
+        if (!total_itens) printf("Consumidor %zu: Consumindo %d\n", consumer_id, data);
         remover = (remover + 1) % TAMANHO;
         count--;
         
@@ -81,19 +114,50 @@ void *consumidor(void *arg) {
         // Release the lock
         pthread_mutex_unlock(&buffer_mutex);
         
-        usleep(rand() % 1000000);  // Random sleep up to 1 second
+        if (data == PILULA) break;
+        consumidos[consumer_id]++;
+
+        if (!total_itens) usleep(rand() % 1000000);  // Random sleep up to 1 second
     }
     
+    cpu_consumidor[consumer_id] = agora(CLOCK_THREAD_CPUTIME_ID);
     return NULL;
 }
 
-int main() {
+void relatorio(const char *nome, double wall) {
+    struct rusage ru;
+    getrusage(RUSAGE_SELF, &ru);
+    double user = ru.ru_utime.tv_sec + ru.ru_utime.tv_usec / 1e6;
+    double sys = ru.ru_stime.tv_sec + ru.ru_stime.tv_usec / 1e6;
+
+    size_t total = 0;
+    for (size_t i = 0; i < NUM_CONSUMIDORES; i++) total += consumidos[i];
+
+    printf("%s\titens=%zu\twall=%.6fs\titens/s=%.0f\tuser=%.6fs\tsys=%.6fs\tnvcsw=%ld\tnivcsw=%ld\n",
+           nome, total, wall, total / wall, user, sys, ru.ru_nvcsw, ru.ru_nivcsw);
+    printf("%s\tprodutor\tcpu=%.6fs\n", nome, cpu_produtor);
+    for (size_t i = 0; i < NUM_CONSUMIDORES; i++) {
+        printf("%s\tconsumidor %zu\titens=%zu\tcpu=%.6fs\n",
+               nome, i, consumidos[i], cpu_consumidor[i]);
+    }
+}
+
+int main(int argc, char *argv[]) {
     pthread_t prod_thread;
     pthread_t cons_threads[NUM_CONSUMIDORES];
     size_t i;
     
+    if (argc > 1) total_itens = strtoull(argv[1], NULL, 10);
+    // Items travel through the buffer as int, next to the poison pill
+    if (total_itens > INT_MAX) {
+        fprintf(stderr, "at most %d items\n", INT_MAX);
+        return 1;
+    }
+
     // Seed the random number generator
     srand(time(NULL));
+
+    double inicio = agora(CLOCK_MONOTONIC);
     
     // Create producer thread
     pthread_create(&prod_thread, NULL, produtor, NULL);
@@ -102,6 +166,16 @@ int main() {
     for (i = 0; i < NUM_CONSUMIDORES; i++) {
         pthread_create(&cons_threads[i], NULL, consumidor, (void *)i);
     }
+
+    if (total_itens) {
+        // Drain mode: every thread finishes on its own after the poison pills
+        pthread_join(prod_thread, NULL);
+        for (i = 0; i < NUM_CONSUMIDORES; i++) {
+            pthread_join(cons_threads[i], NULL);
+        }
+        relatorio("condition_var", agora(CLOCK_MONOTONIC) - inicio);
+        return 0;
+    }
     
     // Run for a few seconds
     printf("Running for %d seconds...\n", RUNTIME_SECONDS);
@@ -111,4 +185,4 @@ int main() {
     printf("For demonstration purposes, we're exiting directly to avoid handling thread cancellation.\n");
     
     return 0;
-}
\ No newline at end of file
+}
@@ -3,6 +3,9 @@
  * 
  * This implementation uses a mutex to protect the critical sections
  * where shared resources are accessed.
+ *
+ * Usage: ./mutex_solution            timed demo for RUNTIME_SECONDS
+ *        ./mutex_solution <items>    run-to-completion (drain) mode
  */
 
 #include <stdio.h>
@@ -10,11 +13,17 @@
 #include <pthread.h>
 #include <unistd.h>
 #include <time.h>
+#include <sched.h>
+#include <limits.h>
+#include <sys/resource.h>
 
 #define TAMANHO 10
 #define NUM_CONSUMIDORES 2
 #define RUNTIME_SECONDS 5
 
+// Poison pill: one per consumer is enqueued after the last item in drain mode
+#define PILULA (-1)
+
 volatile int dados[TAMANHO];
 volatile size_t inserir = 0;
 volatile size_t remover = 0;
@@ -22,37 +31,64 @@ volatile size_t remover = 0;
 // Mutex for protecting the shared buffer and indices
 pthread_mutex_t buffer_mutex = PTHREAD_MUTEX_INITIALIZER;
 
-void *produtor(void *arg) {
-    int v;
-    for (v = 1;; v++) {
-        int can_insert = 0;
-        
-        while (!can_insert) {
-            // Acquire the lock to check buffer status
-            pthread_mutex_lock(&buffer_mutex);
-            
-            // Check if there's space in the buffer
-            if (((inserir + 1) % TAMANHO) != remover) {
-                can_insert = 1;
-                
-                // Critical section - insert into buffer
-                printf("Produzindo %d\n", v);
-                dados[inserir] = v;
-                inserir = (inserir + 1) % TAMANHO;
-            }
-            
-            // Release the lock
-            pthread_mutex_unlock(&buffer_mutex);
-            
-            if (!can_insert) {
-                // If buffer is full, yield and try again later
-                usleep(10000);  // Sleep 10ms before trying again
-            }
+// Drain mode: 0 keeps the timed demo, otherwise exact number of items
+size_t total_itens = 0;
+
+// Per-thread accounting, each slot written only by its own thread
+size_t consumidos[NUM_CONSUMIDORES];
+double cpu_consumidor[NUM_CONSUMIDORES];
+double cpu_produtor;
+
+double agora(clockid_t clock) {
+    struct timespec ts;
+    clock_gettime(clock, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+void inserir_item(int v) {
+    int can_insert = 0;
+
+    while (!can_insert) {
+        // Acquire the lock to check buffer status
+        pthread_mutex_lock(&buffer_mutex);
+
+        // Check if there's space in the buffer
+        if (((inserir + 1) % TAMANHO) != remover) {
+            can_insert = 1;
+
+            // Critical section - insert into buffer
+            if (!total_itens) printf("Produzindo %d\n", v);
+            dados[inserir] = v;
+            inserir = (inserir + 1) % TAMANHO;
+        }
+
+        // Release the lock
+        pthread_mutex_unlock(&buffer_mutex);
+
+        if (!can_insert) {
+            // If buffer is full, yield and try again later. Drain mode only
+            // gives up the CPU, so the benchmark times the mutex, not the sleeps
+            if (total_itens) sched_yield();
+            else usleep(10000);  // Sleep 10ms before trying again
         }
+    }
+}
+
+void *produtor(void *arg) {
+    // Counted in size_t so the last item, INT_MAX at most, doesn't overflow v
+    size_t v;
+    for (v = 1; !total_itens || v <= total_itens; v++) {
+        inserir_item((int)v);
         
-        usleep(500000);  // Sleep for 500ms
+        if (!total_itens) usleep(500000);  // Sleep for 500ms
     }
     
+    // Only reached in drain mode: tell every consumer to stop
+    for (size_t i = 0; i < NUM_CONSUMIDORES; i++) {
+        inserir_item(PILULA);
+    }
+
+    cpu_produtor = agora(CLOCK_THREAD_CPUTIME_ID);
     return NULL;
 }
 
@@ -73,7 +109,7 @@ void *consumidor(void *arg) {
                 
                 // Critical section - consume from buffer
                 data = dados[remover];
-                printf("Consumidor %zu: Consumindo %d\n", consumer_id, data);
+                if (!total_itens) printf("Consumidor %zu: Consumindo %d\n", consumer_id, data);
                 remover = (remover + 1) % TAMANHO;
             }
             
@@ -82,23 +118,55 @@ void *consumidor(void *arg) {
             
             if (!can_consume) {
                 // If buffer is empty, yield and try again later
-                usleep(10000);  // Sleep 10ms before trying again
+                if (total_itens) sched_yield();
+                else usleep(10000);  // Sleep 10ms before trying again
             }
         }
         
-        usleep(rand() % 1000000);  // Random sleep up to 1 second
+        if (data == PILULA) break;
+        consumidos[consumer_id]++;
+
+        if (!total_itens) usleep(rand() % 1000000);  // Random sleep up to 1 second
     }
     
+    cpu_consumidor[consumer_id] = agora(CLOCK_THREAD_CPUTIME_ID);
     return NULL;
 }
 
-int main() {
+void relatorio(const char *nome, double wall) {
+    struct rusage ru;
+    getrusage(RUSAGE_SELF, &ru);
+    double user = ru.ru_utime.tv_sec + ru.ru_utime.tv_usec / 1e6;
+    double sys = ru.ru_stime.tv_sec + ru.ru_stime.tv_usec / 1e6;
+
+    size_t total = 0;
+    for (size_t i = 0; i < NUM_CONSUMIDORES; i++) total += consumidos[i];
+
+    printf("%s\titens=%zu\twall=%.6fs\titens/s=%.0f\tuser=%.6fs\tsys=%.6fs\tnvcsw=%ld\tnivcsw=%ld\n",
+           nome, total, wall, total / wall, user, sys, ru.ru_nvcsw, ru.ru_nivcsw);
+    printf("%s\tprodutor\tcpu=%.6fs\n", nome, cpu_produtor);
+    for (size_t i = 0; i < NUM_CONSUMIDORES; i++) {
+        printf("%s\tconsumidor %zu\titens=%zu\tcpu=%.6fs\n",
+               nome, i, consumidos[i], cpu_consumidor[i]);
+    }
+}
+
+int main(int argc, char *argv[]) {
     pthread_t prod_thread;
     pthread_t cons_threads[NUM_CONSUMIDORES];
     size_t i;
     
+    if (argc > 1) total_itens = strtoull(argv[1], NULL, 10);
+    // Items travel through the buffer as int, next to the poison pill
+    if (total_itens > INT_MAX) {
+        fprintf(stderr, "at most %d items\n", INT_MAX);
+        return 1;
+    }
+
     // Seed the random number generator
     srand(time(NULL));
+
+    double inicio = agora(CLOCK_MONOTONIC);
     
     // Create producer thread
     pthread_create(&prod_thread, NULL, produtor, NULL);
@@ -107,6 +175,16 @@ int main() {
     for (i = 0; i < NUM_CONSUMIDORES; i++) {
         pthread_create(&cons_threads[i], NULL, consumidor, (void *)i);
     }
+
+    if (total_itens) {
+        // Drain mode: every thread finishes on its own after the poison pills
+        pthread_join(prod_thread, NULL);
+        for (i = 0; i < NUM_CONSUMIDORES; i++) {
+            pthread_join(cons_threads[i], NULL);
+        }
+        relatorio("mutex", agora(CLOCK_MONOTONIC) - inicio);
+        return 0;
+    }
     
     // Run for a few seconds
     printf("Running for %d seconds...\n", RUNTIME_SECONDS);
@@ -116,4 +194,4 @@ int main() {
     printf("For demonstration purposes, we're exiting directly to avoid handling thread cancellation.\n");
     
     return 0;
-}
\ No newline at end of file
+}